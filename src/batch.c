@@ -0,0 +1,657 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The batch mode. A batch is a stream of jobs, one per line, each of which
+  plays a series of battles between two warriors, or a round-robin
+  tournament between more, and writes out its results as a line of JSON as
+  soon as it is over. A warrior is assembled the first time a job needs it
+  and is then kept for the jobs that follow along with a hash of its file,
+  which is read again for every job so that a warrior whose file has been
+  changed since is assembled again.
+
+  A job is a line of words separated by blanks:
+
+    [id=ID] [rounds=N] [seed=N] [stride=N] [spread=0|1] FILE1 FILE2...
+
+  where FILE1, FILE2 and so on are the files holding the warriors. The
+  other words, in any order, override the settings given on the command
+  line for the job: ID names the job in its results, ROUNDS is the number
+  of battles between every pair of warriors, SEED is the seed for placing
+  the warriors, STRIDE, if not 0, is the step between the placements of a
+  sweep (see "-x") and SPREAD tells whether to spread the placements
+  evenly (see "-q"). Blank lines and lines starting with "#" are
+  skipped.
+
+  The results of a job are written out as a line like
+
+    {"id":"ID","warriors":["NAME1","NAME2"],"rounds":N,"seed":N,
+     "wins":[N,N],"ties":N,"scores":[N,N]}
+
+  (without the line break), where the scores are the total scores of the
+  warriors. With more than two warriors, the wins and the ties are replaced
+  by "matrix":[[N,N,...],...], the score of every warrior against every
+  other one. If the job could not be run, its results are instead
+
+    {"id":"ID","error":"MESSAGE"}
+
+  The ID of a job is the number of its line unless given.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zinc.h"
+#include "zasm.h"
+#include "tourney.h"
+#include "batch.h"
+
+/* A job in a batch. */
+typedef struct job
+{
+  /* The name of the job in its results. */
+  const char *id;
+
+  /* The files holding the warriors. */
+  const char **files;
+
+  /* The number of warriors. */
+  unsigned int num_files;
+
+  /* The number of battles between the warriors. */
+  unsigned int num_rounds;
+
+  /* The seed for placing the warriors. */
+  uint64_t seed;
+
+  /* The step between the placements of a sweep, or 0 if the warriors are
+     not placed by a sweep. */
+  unsigned int stride;
+
+  /* Flag that indicates whether to spread the placements evenly. */
+  bool spread;
+} job_t;
+
+/* A warrior assembled for the jobs so far. */
+typedef struct known_warrior
+{
+  /* The assembled warrior. */
+  warrior_t warrior;
+
+  /* The hash of the contents of its file when it was assembled. */
+  uint64_t hash;
+} known_warrior_t;
+
+/* The warriors assembled for the jobs so far. */
+static known_warrior_t *known_warriors = NULL;
+static unsigned int num_known = 0U;
+
+
+/* Computes the FNV-1a hash of the contents of the file FILE and stores it
+   in *HASH. Returns 0 on success and 1 on failure. */
+static int
+hash_file (const char *file, uint64_t *hash)
+{
+  int error = 0;
+  FILE *in = fopen (file, "rb");
+  int c;
+
+  *hash = 14695981039346656037ULL;
+  if (in == NULL)
+  {
+    error = 1;
+  }
+  else
+  {
+    while ((c = getc (in)) != EOF)
+    {
+      *hash = (*hash ^ (uint64_t )(unsigned char )c) * 1099511628211ULL;
+    }
+    if (ferror (in))
+    {
+      error = 1;
+    }
+    fclose (in);
+  }
+
+  return error;
+}
+
+
+/* Frees the memory held by the assembled warrior W, but not its file. */
+static void
+free_known_warrior (warrior_t *w)
+{
+  if (w->name != w->file)
+  {
+    free (w->name);
+  }
+  free (w->version);
+  free (w->author);
+  free (w->insns);
+}
+
+
+/* Finds the warrior in the file FILE among the warriors assembled so far,
+   assembling it if it is not there or if its file has changed since it
+   was assembled, and stores its index in *INDEX. Returns 0 on success and
+   1 on failure. */
+static int
+find_warrior (const char *file, unsigned int *index)
+{
+  int error = 0;
+  unsigned int i = 0U;
+  uint64_t hash = 0U;
+  warrior_t w;
+
+  while (i < num_known && strcmp (known_warriors[i].warrior.file, file) != 0)
+  {
+    i++;
+  }
+
+  error = hash_file (file, &hash);
+
+  if (error == 0 && i < num_known && known_warriors[i].hash == hash)
+  {
+    /* The warrior is already assembled. */
+  }
+  else if (error == 0)
+  {
+    memset (&w, 0, sizeof (warrior_t));
+    w.id = UNKNOWN_WARRIOR + 1U;
+    w.file = (char *)malloc (strlen (file) + 1U);
+    if (w.file == NULL)
+    {
+      error = 1;
+    }
+    else
+    {
+      strcpy (w.file, file);
+      error = assemble_warrior (&w);
+      if (error != 0)
+      {
+        free (w.file);
+      }
+    }
+
+    if (error == 0 && w.name == NULL)
+    {
+      w.name = w.file;
+    }
+  }
+
+  if (error != 0 || (i < num_known && known_warriors[i].hash == hash))
+  {
+    /* There is nothing to add. */
+  }
+  else if (i < num_known)
+  {
+    /* The warrior that was assembled from the old contents of the file
+       gives way to the new one. */
+    free_known_warrior (&known_warriors[i].warrior);
+    free (known_warriors[i].warrior.file);
+    known_warriors[i].warrior = w;
+    known_warriors[i].hash = hash;
+  }
+  else
+  {
+    known_warrior_t *more
+      = (known_warrior_t *)realloc (known_warriors,
+                                    (num_known + 1U)
+                                    * sizeof (known_warrior_t));
+
+    if (more == NULL)
+    {
+      free_known_warrior (&w);
+      free (w.file);
+      error = 1;
+    }
+    else
+    {
+      known_warriors = more;
+      known_warriors[num_known].warrior = w;
+      known_warriors[num_known].hash = hash;
+      num_known++;
+    }
+  }
+
+  *index = i;
+
+  return error;
+}
+
+
+/* Reads the value of the word VALUE, which must be a number, into *NUMBER.
+   Returns 0 on success and 1 on failure. */
+static int
+get_number (const char *value, unsigned long long *number)
+{
+  char *end = NULL;
+
+  *number = strtoull (value, &end, 10);
+
+  return (value[0] < '0' || value[0] > '9' || *end != '\0') ? 1 : 0;
+}
+
+
+/* Parses the job in LINE, which is changed in the process, into JOB, whose
+   settings must already hold the ones to use if the line does not give
+   them and whose files must have room for every word of the line. Returns
+   NULL on success and a message saying what is wrong with the line
+   otherwise. */
+static const char *
+parse_job (char *line, job_t *job)
+{
+  const char *message = NULL;
+  unsigned long long value = 0U;
+
+  for (char *word = strtok (line, " \t\r\n"); message == NULL && word != NULL;
+       word = strtok (NULL, " \t\r\n"))
+  {
+    if (strncmp (word, "id=", 3U) == 0)
+    {
+      job->id = word + 3;
+    }
+    else if (strncmp (word, "rounds=", 7U) == 0)
+    {
+      if (get_number (word + 7, &value) != 0 || value == 0U
+          || value > UINT32_MAX)
+      {
+        message = "Invalid number of rounds.";
+      }
+      job->num_rounds = (unsigned int )value;
+    }
+    else if (strncmp (word, "seed=", 5U) == 0)
+    {
+      if (get_number (word + 5, &value) != 0)
+      {
+        message = "Invalid seed.";
+      }
+      job->seed = value;
+    }
+    else if (strncmp (word, "stride=", 7U) == 0)
+    {
+      if (get_number (word + 7, &value) != 0)
+      {
+        message = "Invalid stride.";
+      }
+      job->stride = (value < core_size) ? (unsigned int )value : core_size;
+    }
+    else if (strncmp (word, "spread=", 7U) == 0)
+    {
+      if (get_number (word + 7, &value) != 0 || value > 1U)
+      {
+        message = "Invalid spread.";
+      }
+      job->spread = (value == 1U);
+    }
+    else
+    {
+      job->files[job->num_files] = word;
+      job->num_files++;
+    }
+  }
+
+  if (message == NULL && job->num_files < 2U)
+  {
+    message = "At least two warriors are needed.";
+  }
+
+  return message;
+}
+
+
+/* Writes out the string S to OUT as a JSON string. */
+static void
+put_json_string (FILE *out, const char *s)
+{
+  fputc ('"', out);
+  for (; *s != '\0'; s++)
+  {
+    unsigned char c = (unsigned char )*s;
+
+    if (c == '"' || c == '\\')
+    {
+      fprintf (out, "\\%c", c);
+    }
+    else if (c < 0x20U)
+    {
+      fprintf (out, "\\u%04x", c);
+    }
+    else
+    {
+      fputc (c, out);
+    }
+  }
+  fputc ('"', out);
+}
+
+
+/* Runs the job JOB, running up to NUM_THREADS battles at once, and writes
+   out its results to OUT. Returns 0 on success and 1 if the job could not
+   be run. */
+static int
+run_job (const job_t *job, unsigned int num_threads, FILE *out)
+{
+  int error = 0;
+  char message[MAX_BATCH_LINE_LEN + 64];
+  unsigned int n = job->num_files;
+  unsigned int num_pairings = n * (n - 1U) / 2U;
+  unsigned int num_rounds = job->num_rounds;
+  uint64_t num_battles = 0U;
+  warrior_t *entrants = (warrior_t *)malloc (n * sizeof (warrior_t));
+  unsigned int *indices = (unsigned int *)malloc (n * sizeof (unsigned int));
+  pairing_t *pairings
+    = (pairing_t *)malloc (num_pairings * sizeof (pairing_t));
+  uint32_t *matrix = (uint32_t *)calloc (n * n, sizeof (uint32_t));
+  uint32_t (*scores)[2] = NULL;
+  uint32_t wins[2] = { 0U, 0U }, ties = 0U;
+
+  if (entrants == NULL || indices == NULL || pairings == NULL
+      || matrix == NULL)
+  {
+    snprintf (message, sizeof (message), "Unable to allocate memory for "
+              "battles.");
+    error = 1;
+  }
+
+  /* The warriors are only copied once they have all been found, since
+     finding a warrior whose file has changed replaces the warrior. They
+     are copied so that a warrior can meet itself. */
+  for (unsigned int i = 0U; error == 0 && i < n; i++)
+  {
+    if (find_warrior (job->files[i], &indices[i]) != 0)
+    {
+      snprintf (message, sizeof (message), "Unable to assemble \"%s\".",
+                job->files[i]);
+      error = 1;
+    }
+  }
+  for (unsigned int i = 0U; error == 0 && i < n; i++)
+  {
+    entrants[i] = known_warriors[indices[i]].warrior;
+  }
+
+  if (error == 0 && (job->stride != 0U || job->spread == true)
+      && tourney_sweep_rounds (1U) == 0U)
+  {
+    snprintf (message, sizeof (message), "The core is too small for the "
+              "placements.");
+    error = 1;
+  }
+  else if (error == 0 && job->stride != 0U)
+  {
+    num_rounds = tourney_sweep_rounds (job->stride);
+  }
+
+  num_battles = (uint64_t )num_pairings * num_rounds;
+  if (error == 0 && (n > UINT16_MAX || num_battles > UINT32_MAX))
+  {
+    snprintf (message, sizeof (message), "Too many battles.");
+    error = 1;
+  }
+  else if (error == 0)
+  {
+    scores = (uint32_t (*)[2])malloc (num_battles * sizeof (uint32_t[2]));
+    if (scores == NULL)
+    {
+      snprintf (message, sizeof (message), "Unable to allocate memory for "
+                "battles.");
+      error = 1;
+    }
+  }
+
+  if (error == 0)
+  {
+    unsigned int k = 0U;
+
+    for (unsigned int i = 0U; i < n; i++)
+    {
+      for (unsigned int j = i + 1U; j < n; j++)
+      {
+        pairings[k].first = i;
+        pairings[k].second = j;
+        k++;
+      }
+    }
+
+    if (tourney_play (entrants, pairings, num_pairings, num_rounds,
+                      num_threads, job->seed, job->stride, job->spread,
+                      scores) != 0)
+    {
+      snprintf (message, sizeof (message), "Unable to play the battles.");
+      error = 1;
+    }
+  }
+
+  if (error == 0)
+  {
+    for (unsigned int b = 0U; b < num_battles; b++)
+    {
+      pairing_t *p = &pairings[b / num_rounds];
+
+      matrix[p->first * n + p->second] += scores[b][0];
+      matrix[p->second * n + p->first] += scores[b][1];
+      if (scores[b][0] > scores[b][1])
+      {
+        wins[0]++;
+      }
+      else if (scores[b][0] < scores[b][1])
+      {
+        wins[1]++;
+      }
+      else
+      {
+        ties++;
+      }
+    }
+  }
+
+  fprintf (out, "{\"id\":");
+  put_json_string (out, job->id);
+  if (error == 0)
+  {
+    fprintf (out, ",\"warriors\":[");
+    for (unsigned int i = 0U; i < n; i++)
+    {
+      fprintf (out, (i == 0U) ? "" : ",");
+      put_json_string (out, entrants[i].name);
+    }
+    fprintf (out, "],\"rounds\":%u,\"seed\":%" PRIu64, num_rounds,
+             job->seed);
+
+    /* The wins and ties are only given for a pair of warriors, and the
+       score of every warrior against every other one only for more. */
+    if (n == 2U)
+    {
+      fprintf (out, ",\"wins\":[%" PRIu32 ",%" PRIu32 "],\"ties\":%"
+               PRIu32, wins[0], wins[1], ties);
+    }
+    else
+    {
+      fprintf (out, ",\"matrix\":[");
+      for (unsigned int i = 0U; i < n; i++)
+      {
+        for (unsigned int j = 0U; j < n; j++)
+        {
+          fprintf (out, "%s%" PRIu32, (j == 0U) ? ((i == 0U) ? "[" : ",[")
+                   : ",", matrix[i * n + j]);
+        }
+        fputc (']', out);
+      }
+      fputc (']', out);
+    }
+
+    fprintf (out, ",\"scores\":[");
+    for (unsigned int i = 0U; i < n; i++)
+    {
+      uint32_t total = 0U;
+
+      for (unsigned int j = 0U; j < n; j++)
+      {
+        total += matrix[i * n + j];
+      }
+      fprintf (out, "%s%" PRIu32, (i == 0U) ? "" : ",", total);
+    }
+    fprintf (out, "]}\n");
+  }
+  else
+  {
+    fprintf (out, ",\"error\":");
+    put_json_string (out, message);
+    fprintf (out, "}\n");
+  }
+  fflush (out);
+
+  free (entrants);
+  free (indices);
+  free (pairings);
+  free (matrix);
+  free (scores);
+
+  return error;
+}
+
+
+/* Runs the job in LINE, the LINE_NUM-th line of a batch, running up to
+   NUM_THREADS of its battles at once, and writes out its results to OUT.
+   If TOO_LONG is true, LINE only holds the start of a line that was too
+   long and the job is not run. The job plays NUM_ROUNDS battles with the
+   seed SEED, placing the warriors by a sweep if STRIDE is not 0 and
+   spreading the placements evenly if SPREAD is true, unless it says
+   otherwise. A blank line or a comment is skipped. Returns 0 if the job
+   was run or skipped and 1 otherwise. */
+int
+batch_run_job (char *line, bool too_long, unsigned int line_num, FILE *out,
+               unsigned int num_rounds, unsigned int num_threads,
+               uint64_t seed, unsigned int stride, bool spread)
+{
+  int error = 0;
+  char line_id[16];
+  size_t start = strspn (line, " \t\r\n");
+  job_t job;
+  const char *message = NULL;
+
+  /* Every word of a line is at least a character followed by a blank. */
+  const char **files
+    = (const char **)malloc ((MAX_BATCH_LINE_LEN / 2U + 1U)
+                             * sizeof (const char *));
+
+  snprintf (line_id, sizeof (line_id), "%u", line_num);
+  job.id = line_id;
+  job.files = files;
+  job.num_files = 0U;
+  job.num_rounds = num_rounds;
+  job.seed = seed;
+  job.stride = stride;
+  job.spread = spread;
+
+  if (line[start] == '\0' || line[start] == '#')
+  {
+    /* Nothing to do. */
+  }
+  else if (files == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for jobs.\n\n");
+    error = 1;
+  }
+  else
+  {
+    if (too_long == true)
+    {
+      message = "The line is too long.";
+    }
+    else
+    {
+      message = parse_job (line, &job);
+    }
+
+    if (message != NULL)
+    {
+      fprintf (out, "{\"id\":");
+      put_json_string (out, job.id);
+      fprintf (out, ",\"error\":");
+      put_json_string (out, message);
+      fprintf (out, "}\n");
+      fflush (out);
+      error = 1;
+    }
+    else if (run_job (&job, num_threads, out) != 0)
+    {
+      error = 1;
+    }
+  }
+  free (files);
+
+  return error;
+}
+
+
+/* Runs the jobs read from IN one after the other, running up to
+   NUM_THREADS battles of a job at once, and writes out the results of
+   every job to OUT as soon as it is over. A job plays NUM_ROUNDS battles
+   with the seed SEED, placing the warriors by a sweep if STRIDE is not 0
+   and spreading the placements evenly if SPREAD is true, unless it says
+   otherwise. Returns 0 if every job was run and 1 otherwise. */
+int
+batch_run (FILE *in, FILE *out, unsigned int num_rounds,
+           unsigned int num_threads, uint64_t seed, unsigned int stride,
+           bool spread)
+{
+  int error = 0;
+  char line[MAX_BATCH_LINE_LEN + 1];
+  unsigned int line_num = 0U;
+
+  while (fgets (line, sizeof (line), in) != NULL)
+  {
+    size_t len = strlen (line);
+    bool too_long = (len > 0U && line[len - 1U] != '\n' && !feof (in));
+
+    line_num++;
+    if (too_long == true)
+    {
+      /* Skip the rest of a line that is too long. */
+      int c = 0;
+
+      while ((c = fgetc (in)) != EOF && c != '\n')
+      {
+      }
+    }
+
+    if (batch_run_job (line, too_long, line_num, out, num_rounds,
+                       num_threads, seed, stride, spread) != 0)
+    {
+      error = 1;
+    }
+  }
+
+  if (ferror (in) || ferror (out))
+  {
+    fprintf (stderr, "ERROR: Unable to read the jobs or write their "
+             "results.\n\n");
+    error = 1;
+  }
+
+  return error;
+}
+
+
+/* Frees the memory held by the warriors assembled for the jobs. */
+void
+batch_free (void)
+{
+  for (unsigned int i = 0U; i < num_known; i++)
+  {
+    free_known_warrior (&known_warriors[i].warrior);
+    free (known_warriors[i].warrior.file);
+  }
+  free (known_warriors);
+  known_warriors = NULL;
+  num_known = 0U;
+}
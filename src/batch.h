@@ -0,0 +1,28 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the batch mode.
+*/
+
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+/* The maximum number of characters in a line of a batch. */
+#define MAX_BATCH_LINE_LEN (2 * FILENAME_MAX + 128)
+
+extern int
+batch_run_job (char *line, bool too_long, unsigned int line_num, FILE *out,
+               unsigned int num_rounds, unsigned int num_threads,
+               uint64_t seed, unsigned int stride, bool spread);
+
+extern int
+batch_run (FILE *in, FILE *out, unsigned int num_rounds,
+           unsigned int num_threads, uint64_t seed, unsigned int stride,
+           bool spread);
+
+extern void batch_free (void);
+
+#endif /* BATCH_H_INCLUDED */
@@ -0,0 +1,536 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  A cache of the results of battles kept in a file, so that a battle that
+  has already been fought need not be fought again.
+
+  The outcome of a battle only depends on the assembled instructions of
+  the warriors and the offsets at which they start, the order in which they
+  move and the limits on the battle, since the core is otherwise uniform.
+  A battle is therefore looked up by a hash of exactly these, so that a
+  warrior whose name, author or comments have changed, or that has been
+  loaded at other addresses with the same offsets, still finds its results.
+
+  The file holds a header followed by an open-addressing hash table of
+  fixed-size entries. Where possible the file is mapped into memory, so
+  that only the parts of it that are used are read in and a new result is
+  written out without rewriting the file. Several processes can then share
+  the file, since every look-up and every new result locks it. Elsewhere,
+  the whole file is read in when it is opened and written back when it is
+  closed.
+*/
+
+/* mmap() and POSIX threads are not part of C99. */
+#if defined (__unix__) || defined (__APPLE__)
+#define ZINC_MAPPED_CACHE
+#endif
+#if defined (ZINC_MAPPED_CACHE) || defined (ZINC_THREADS)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ZINC_MAPPED_CACHE
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef ZINC_THREADS
+#include <pthread.h>
+#endif
+
+#include "zinc.h"
+#include "mars.h"
+#include "cache.h"
+
+/* The first bytes of a file holding a cache. The last byte is the version
+   of the format of the file, which must be changed whenever the outcome of
+   a battle might change. */
+#define CACHE_MAGIC "ZINCMEM\001"
+
+/* The header of a file holding a cache. */
+typedef struct cache_header
+{
+  char magic[8];
+
+  /* The number of entries in the hash table, a power of 2. */
+  uint64_t capacity;
+
+  /* The number of entries in use. */
+  uint64_t count;
+} cache_header_t;
+
+/* An entry in the hash table, recording the result of a battle. */
+typedef struct cache_entry
+{
+  /* The hash of the battle, which picks the slot of the entry, or 0 if the
+     entry is not in use. */
+  uint64_t key;
+
+  /* A second hash of the battle, started from KEY instead of 0, that
+     guards against two battles with the same KEY. */
+  uint64_t check;
+
+  /* The status at the end of the battle. */
+  uint8_t status;
+
+  /* The points scored by the warriors in the battle. */
+  uint8_t points[MAX_WARRIORS];
+} cache_entry_t;
+
+/* The file holding the cache, if one is open. */
+static const char *cache_file = NULL;
+
+/* The contents of the file holding the cache. */
+static cache_header_t *header = NULL;
+static cache_entry_t *entries = NULL;
+
+/* The size of the contents of the file. */
+static size_t cache_bytes = 0U;
+
+#ifdef ZINC_MAPPED_CACHE
+/* The file descriptor of the file holding the cache, kept open for
+   locking it. */
+static int cache_fd = -1;
+#endif
+
+#ifdef ZINC_THREADS
+/* Guards the cache against the workers playing battles at once. */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+/* Creates the file FILE holding an empty cache with the header HEADER.
+   Where the file is mapped into memory, another process may be creating
+   it at the same time, so the cache is written to a temporary file first
+   and only then linked to FILE, unless another process got there first.
+   Either way, FILE never holds a cache that is only partly written.
+   Returns 0 on success and 1 on failure. */
+static int
+create_cache (const char *file, const cache_header_t *header)
+{
+  int error = 0;
+  const char *new_file = file;
+  FILE *out = NULL;
+
+#ifdef ZINC_MAPPED_CACHE
+  char *tmp_file = (char *)malloc (strlen (file) + 32U);
+
+  if (tmp_file == NULL)
+  {
+    error = 1;
+  }
+  else
+  {
+    sprintf (tmp_file, "%s.%ld.tmp", file, (long )getpid ());
+    new_file = tmp_file;
+  }
+#endif
+
+  if (error == 0)
+  {
+    out = fopen (new_file, "wb");
+  }
+  if (out == NULL
+      || fwrite (header, sizeof (cache_header_t), 1U, out) != 1U
+      || fseek (out, (long )(header->capacity * sizeof (cache_entry_t))
+                     - 1L, SEEK_CUR) != 0
+      || fputc (0, out) == EOF)
+  {
+    error = 1;
+  }
+  if (out != NULL && fclose (out) != 0)
+  {
+    error = 1;
+  }
+
+#ifdef ZINC_MAPPED_CACHE
+  if (error == 0 && link (new_file, file) != 0 && errno != EEXIST)
+  {
+    error = 1;
+  }
+  if (out != NULL)
+  {
+    remove (new_file);
+  }
+  free (tmp_file);
+#endif
+
+  if (error != 0)
+  {
+    fprintf (stderr, "ERROR: Unable to create the cache in \"%s\".\n\n",
+             file);
+  }
+
+  return error;
+}
+
+
+/* Opens the cache in the file FILE, creating the file with room for
+   DEFAULT_CACHE_SIZE results if it does not exist. Returns 0 on success
+   and 1 on failure. */
+int
+cache_open (const char *file)
+{
+  int error = 0;
+  cache_header_t new_header;
+  FILE *in = fopen (file, "rb");
+
+  memset (&new_header, 0, sizeof (cache_header_t));
+  memcpy (new_header.magic, CACHE_MAGIC, sizeof (new_header.magic));
+  new_header.capacity = DEFAULT_CACHE_SIZE;
+  new_header.count = 0U;
+
+  if (in == NULL)
+  {
+    error = create_cache (file, &new_header);
+  }
+  else
+  {
+    if (fread (&new_header, sizeof (cache_header_t), 1U, in) != 1U
+        || memcmp (new_header.magic, CACHE_MAGIC, sizeof (new_header.magic))
+           != 0
+        || new_header.capacity == 0U
+        || (new_header.capacity & (new_header.capacity - 1U)) != 0U
+        || new_header.capacity > SIZE_MAX / sizeof (cache_entry_t) / 2U)
+    {
+      fprintf (stderr, "ERROR: \"%s\" does not hold a cache of this "
+               "version of ZINC.\n\n", file);
+      error = 1;
+    }
+    fclose (in);
+  }
+
+  if (error == 0)
+  {
+    cache_bytes = sizeof (cache_header_t)
+                  + new_header.capacity * sizeof (cache_entry_t);
+
+#ifdef ZINC_MAPPED_CACHE
+    int fd = open (file, O_RDWR);
+    struct stat st;
+    void *map = MAP_FAILED;
+
+    if (fd >= 0 && fstat (fd, &st) == 0
+        && (size_t )st.st_size >= cache_bytes)
+    {
+      map = mmap (NULL, cache_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                  0);
+    }
+    if (map != MAP_FAILED)
+    {
+      header = (cache_header_t *)map;
+      cache_fd = fd;
+    }
+    else if (fd >= 0)
+    {
+      close (fd);
+    }
+#else
+    in = fopen (file, "rb");
+    header = (cache_header_t *)malloc (cache_bytes);
+    if (in != NULL && header != NULL
+        && fread (header, cache_bytes, 1U, in) != 1U)
+    {
+      free (header);
+      header = NULL;
+    }
+    if (in != NULL)
+    {
+      fclose (in);
+    }
+#endif
+
+    if (header == NULL)
+    {
+      fprintf (stderr, "ERROR: Unable to read the cache in \"%s\".\n\n",
+               file);
+      error = 1;
+    }
+    else
+    {
+      entries = (cache_entry_t *)(header + 1);
+      cache_file = file;
+    }
+  }
+
+  return error;
+}
+
+
+/* Closes the cache, if one is open, writing it back to its file if
+   necessary. Returns 0 on success and 1 on failure. */
+int
+cache_close (void)
+{
+  int error = 0;
+
+  if (header != NULL)
+  {
+#ifdef ZINC_MAPPED_CACHE
+    if (munmap (header, cache_bytes) != 0)
+    {
+      error = 1;
+    }
+    close (cache_fd);
+    cache_fd = -1;
+#else
+    FILE *out = fopen (cache_file, "r+b");
+
+    if (out == NULL || fwrite (header, cache_bytes, 1U, out) != 1U)
+    {
+      error = 1;
+    }
+    if (out != NULL && fclose (out) != 0)
+    {
+      error = 1;
+    }
+    free (header);
+#endif
+
+    if (error != 0)
+    {
+      fprintf (stderr, "ERROR: Unable to write the cache in \"%s\".\n\n",
+               cache_file);
+    }
+  }
+
+  header = NULL;
+  entries = NULL;
+  cache_file = NULL;
+
+  return error;
+}
+
+
+/* Mixes the value V into the hash H. */
+static uint64_t
+hash_in (uint64_t h, uint64_t v)
+{
+  h ^= v;
+  h *= UINT64_C (0x100000001B3);
+
+  return h ^ (h >> 29);
+}
+
+
+/* Finishes off the hash H so that every bit of it depends on every bit of
+   the values mixed into it. */
+static uint64_t
+hash_out (uint64_t h)
+{
+  h = (h ^ (h >> 30)) * UINT64_C (0xBF58476D1CE4E5B9);
+  h = (h ^ (h >> 27)) * UINT64_C (0x94D049BB133111EB);
+
+  return h ^ (h >> 31);
+}
+
+
+/* Computes the hash of the battle about to be fought in the simulator M,
+   starting with the value H. */
+static uint64_t
+hash_battle (const mars_t *m, uint64_t h)
+{
+  h = hash_in (h, core_size);
+  h = hash_in (h, m->max_cycles);
+  h = hash_in (h, m->max_prog_tasks);
+  h = hash_in (h, min_prog_separation);
+  h = hash_in (h, m->num_warriors);
+
+  /* The warriors are given in the order in which they move. */
+  for (unsigned int i = 0U; i < m->num_warriors; i++)
+  {
+    const warrior_t *w = &m->warriors[i];
+    cell_addr_t offset = (core_size + w->load_addr
+                          - m->warriors[0].load_addr) % core_size;
+
+    h = hash_in (h, offset);
+    h = hash_in (h, w->init_pc);
+    h = hash_in (h, w->num_insns);
+    for (unsigned int j = 0U; j < w->num_insns; j++)
+    {
+      const cell_t *c = &w->insns[j];
+
+      h = hash_in (h, ((uint64_t )c->op_code << 16) | (c->mode_a << 8)
+                      | c->mode_b);
+      h = hash_in (h, ((uint64_t )c->op_a << 32) | c->op_b);
+    }
+  }
+
+  return hash_out (h);
+}
+
+
+/* Looks up the battle with the hashes KEY and CHECK in the cache. Returns
+   its entry, or the free entry it should be stored in if it is not in the
+   cache, or NULL if it is not in the cache and there is no room for it. */
+static cache_entry_t *
+find_entry (uint64_t key, uint64_t check)
+{
+  uint64_t mask = header->capacity - 1U;
+  cache_entry_t *ret_val = NULL;
+
+  for (uint64_t i = 0U; ret_val == NULL && i <= mask; i++)
+  {
+    cache_entry_t *e = &entries[(key + i) & mask];
+
+    if (e->key == 0U || (e->key == key && e->check == check))
+    {
+      ret_val = e;
+    }
+  }
+
+  return ret_val;
+}
+
+
+/* Locks the cache against the other threads of this process and, where
+   the file is mapped into memory, against other processes using the same
+   file, for reading only unless WRITE is true. Returns true if the cache
+   is locked, in which case it must be unlocked with unlock_cache(), and
+   false otherwise. */
+static bool
+lock_cache (bool write)
+{
+  bool ret_val = true;
+
+#ifdef ZINC_THREADS
+  pthread_mutex_lock (&cache_lock);
+#endif
+
+#ifdef ZINC_MAPPED_CACHE
+  struct flock lock;
+  int res = 0;
+
+  memset (&lock, 0, sizeof (lock));
+  lock.l_type = (write == true) ? F_WRLCK : F_RDLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = 0;
+  lock.l_len = 0;
+  do
+  {
+    res = fcntl (cache_fd, F_SETLKW, &lock);
+  }
+  while (res != 0 && errno == EINTR);
+
+  if (res != 0)
+  {
+#ifdef ZINC_THREADS
+    pthread_mutex_unlock (&cache_lock);
+#endif
+    ret_val = false;
+  }
+#else
+  (void )write;
+#endif
+
+  return ret_val;
+}
+
+
+/* Unlocks the cache locked by lock_cache(). */
+static void
+unlock_cache (void)
+{
+#ifdef ZINC_MAPPED_CACHE
+  struct flock lock;
+
+  memset (&lock, 0, sizeof (lock));
+  lock.l_type = F_UNLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = 0;
+  lock.l_len = 0;
+  fcntl (cache_fd, F_SETLK, &lock);
+#endif
+
+#ifdef ZINC_THREADS
+  pthread_mutex_unlock (&cache_lock);
+#endif
+}
+
+
+/* Looks up the result of the battle about to be fought in the simulator M,
+   with the warriors already loaded, in the cache. If it is there, stores
+   the status at the end of the battle in STATUS and the points scored by
+   every warrior in POINTS and returns true. Returns false otherwise. */
+bool
+cache_recall (const mars_t *m, battle_status_t *status, uint32_t points[])
+{
+  bool ret_val = false;
+
+  if (header != NULL)
+  {
+    uint64_t key = hash_battle (m, 0U) | 1U;
+    uint64_t check = hash_battle (m, key);
+
+    if (lock_cache (false) == true)
+    {
+      cache_entry_t *e = find_entry (key, check);
+
+      if (e != NULL && e->key == key)
+      {
+        *status = (battle_status_t )e->status;
+        for (unsigned int i = 0U; i < m->num_warriors; i++)
+        {
+          points[i] = e->points[i];
+        }
+        ret_val = true;
+      }
+
+      unlock_cache ();
+    }
+  }
+
+  return ret_val;
+}
+
+
+/* Stores the result of the battle just fought in the simulator M, which
+   ended with the status STATUS and the points in POINTS scored by every
+   warrior, in the cache. A battle interrupted by the user is not stored
+   and neither is any battle once the cache is three-quarters full. */
+void
+cache_remember (const mars_t *m, battle_status_t status,
+                const uint32_t points[])
+{
+  if (header != NULL
+      && (status == WARRIOR_1_KILLED || status == WARRIOR_2_KILLED
+          || status == CYCLES_EXHAUSTED))
+  {
+    uint64_t key = hash_battle (m, 0U) | 1U;
+    uint64_t check = hash_battle (m, key);
+
+    if (lock_cache (true) == true)
+    {
+      cache_entry_t *e = NULL;
+
+      if (header->count < header->capacity / 4U * 3U)
+      {
+        e = find_entry (key, check);
+      }
+      if (e != NULL && e->key == 0U)
+      {
+        e->check = check;
+        e->status = (uint8_t )status;
+        for (unsigned int i = 0U; i < m->num_warriors; i++)
+        {
+          e->points[i] = (uint8_t )points[i];
+        }
+        e->key = key;
+        header->count++;
+      }
+
+      unlock_cache ();
+    }
+  }
+}
@@ -0,0 +1,27 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the cache of the results of battles.
+*/
+
+#ifndef CACHE_H_INCLUDED
+#define CACHE_H_INCLUDED
+
+/* The number of results a new cache has room for. */
+#define DEFAULT_CACHE_SIZE (1U << 20)
+
+extern int cache_open (const char *file);
+
+extern int cache_close (void);
+
+extern bool
+cache_recall (const mars_t *m, battle_status_t *status, uint32_t points[]);
+
+extern void
+cache_remember (const mars_t *m, battle_status_t status,
+                const uint32_t points[]);
+
+#endif /* CACHE_H_INCLUDED */
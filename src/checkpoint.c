@@ -0,0 +1,249 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The checkpoints of round-robin tournaments. A checkpoint holds the total
+  scores of every pair of warriors that has played all of its battles, so
+  that a tournament that was stopped can go on from where it was without
+  playing those pairs again. Since every battle is seeded on its own from
+  the seed of the tournament and the number of the battle, nothing else
+  needs to be kept for the results of the tournament to be the same as
+  if it had never been stopped.
+
+  The file is a text file with the following lines:
+
+    ZINC checkpoint 1
+    settings CORE-SIZE MAX-CYCLES MAX-INSNS MAX-TASKS MIN-SEPARATION
+    tournament ROUNDS SEED STRIDE SPREAD
+    warrior FILE
+    ...
+    pair I J SCORE-I SCORE-J
+    ...
+
+  with a "warrior" line for every warrior, in the order in which they were
+  given, and a "pair" line for every pair of warriors that has played all
+  of its battles giving the total scores of the I-th warrior and the J-th
+  one against each other, counting from 0, where I < J.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zinc.h"
+#include "checkpoint.h"
+
+/* The first line of a file holding a checkpoint. */
+#define CHECKPOINT_MAGIC "ZINC checkpoint 1"
+
+/* The maximum number of characters in a line of a file holding a
+   checkpoint. */
+#define MAX_CHECKPOINT_LINE_LEN (FILENAME_MAX + 64)
+
+
+/* Returns the number of the pairing of the I-th of NUM_ENTRANTS warriors
+   with the J-th one, where I < J. */
+static unsigned int
+pairing_number (unsigned int num_entrants, unsigned int i, unsigned int j)
+{
+  return (unsigned int )((uint64_t )i * (2U * num_entrants - i - 1U) / 2U
+                         + (j - i - 1U));
+}
+
+
+/* Reads the checkpoint C from its file, if there is one, marking the pairs
+   of warriors in it as done and setting their total scores. Unless the
+   seed in C was given by the user, the seed in the file replaces it, so
+   that a tournament that was placed at random can be resumed without
+   knowing its seed. Returns 0 on success and 1 on failure. */
+int
+checkpoint_read (checkpoint_t *c)
+{
+  int error = 0;
+  char line[MAX_CHECKPOINT_LINE_LEN + 1];
+  unsigned int settings[5] = { 0U, 0U, 0U, 0U, 0U };
+  unsigned int num_rounds = 0U;
+  unsigned long long stored_seed = 0U;
+  unsigned int stride = 0U;
+  unsigned int spread = 0U;
+  unsigned int num_warriors = 0U;
+  unsigned int num_done = 0U;
+  FILE *in = fopen (c->file, "r");
+
+  if (in == NULL)
+  {
+    printf ("Starting a new checkpoint in \"%s\".\n\n", c->file);
+  }
+  else if (fgets (line, sizeof (line), in) == NULL
+           || strncmp (line, CHECKPOINT_MAGIC,
+                       strlen (CHECKPOINT_MAGIC)) != 0
+           || fgets (line, sizeof (line), in) == NULL
+           || sscanf (line, "settings %u %u %u %u %u", &settings[0],
+                      &settings[1], &settings[2], &settings[3],
+                      &settings[4]) != 5
+           || fgets (line, sizeof (line), in) == NULL
+           || sscanf (line, "tournament %u %llu %u %u", &num_rounds,
+                      &stored_seed, &stride, &spread) != 4)
+  {
+    fprintf (stderr, "ERROR: \"%s\" does not hold a checkpoint.\n\n",
+             c->file);
+    error = 1;
+  }
+  else if (settings[0] != core_size || settings[1] != max_cycles
+           || settings[2] != max_prog_insns || settings[3] != max_prog_tasks
+           || settings[4] != min_prog_separation)
+  {
+    fprintf (stderr, "ERROR: The tournament in \"%s\" was played with other "
+             "settings.\n\n", c->file);
+    error = 1;
+  }
+  else if (num_rounds != c->num_rounds || stride != c->stride
+           || (spread != 0U) != c->spread
+           || (c->seed_given == true && stored_seed != c->seed))
+  {
+    fprintf (stderr, "ERROR: The tournament in \"%s\" was played with other "
+             "placements.\n\n", c->file);
+    error = 1;
+  }
+  else
+  {
+    c->seed = stored_seed;
+  }
+
+  while (error == 0 && in != NULL && fgets (line, sizeof (line), in) != NULL)
+  {
+    size_t len = strlen (line);
+    unsigned int i, j;
+    uint32_t totals[2];
+
+    if (len > 0U && line[len - 1U] == '\n')
+    {
+      line[len - 1U] = '\0';
+    }
+
+    if (strncmp (line, "warrior ", 8U) == 0 && num_warriors < c->num_entrants
+        && num_done == 0U
+        && strcmp (line + 8, c->entrants[num_warriors].file) == 0)
+    {
+      num_warriors++;
+    }
+    else if (sscanf (line, "pair %u %u %" SCNu32 " %" SCNu32, &i, &j,
+                     &totals[0], &totals[1]) == 4
+             && num_warriors == c->num_entrants && i < j
+             && j < c->num_entrants)
+    {
+      unsigned int k = pairing_number (c->num_entrants, i, j);
+
+      c->done[k] = true;
+      c->totals[k][0] = totals[0];
+      c->totals[k][1] = totals[1];
+      num_done++;
+    }
+    else
+    {
+      fprintf (stderr, "ERROR: Bad line \"%s\" in the checkpoint in "
+               "\"%s\".\n\n", line, c->file);
+      error = 1;
+    }
+  }
+
+  if (error == 0 && in != NULL && num_warriors != c->num_entrants)
+  {
+    fprintf (stderr, "ERROR: The tournament in \"%s\" was played between "
+             "other warriors.\n\n", c->file);
+    error = 1;
+  }
+
+  if (in != NULL)
+  {
+    fclose (in);
+    if (error == 0)
+    {
+      printf ("Resuming from \"%s\" with %u pairs played.\n\n", c->file,
+              num_done);
+    }
+  }
+
+  return error;
+}
+
+
+/* Writes the checkpoint C to its file. The checkpoint is first written to
+   a temporary file which then replaces the file, so that the file always
+   holds a complete checkpoint. Returns 0 on success and 1 on failure. */
+int
+checkpoint_write (const checkpoint_t *c)
+{
+  int error = 0;
+  char *tmp_file = (char *)malloc (strlen (c->file) + 5U);
+  FILE *out = NULL;
+
+  if (tmp_file == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for the "
+             "checkpoint.\n\n");
+    error = 1;
+  }
+  else
+  {
+    sprintf (tmp_file, "%s.tmp", c->file);
+    out = fopen (tmp_file, "w");
+  }
+
+  if (error == 0 && out == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to write to \"%s\".\n\n", tmp_file);
+    error = 1;
+  }
+  else if (error == 0)
+  {
+    unsigned int k = 0U;
+
+    fprintf (out, "%s\n", CHECKPOINT_MAGIC);
+    fprintf (out, "settings %u %u %u %u %u\n", core_size, max_cycles,
+             max_prog_insns, max_prog_tasks, min_prog_separation);
+    fprintf (out, "tournament %u %" PRIu64 " %u %u\n", c->num_rounds,
+             c->seed, c->stride, (c->spread == true) ? 1U : 0U);
+
+    for (unsigned int i = 0U; i < c->num_entrants; i++)
+    {
+      fprintf (out, "warrior %s\n", c->entrants[i].file);
+    }
+
+    for (unsigned int i = 0U; i < c->num_entrants; i++)
+    {
+      for (unsigned int j = i + 1U; j < c->num_entrants; j++)
+      {
+        if (c->done[k] == true)
+        {
+          fprintf (out, "pair %u %u %" PRIu32 " %" PRIu32 "\n", i, j,
+                   c->totals[k][0], c->totals[k][1]);
+        }
+        k++;
+      }
+    }
+
+    if (fclose (out) != 0)
+    {
+      fprintf (stderr, "ERROR: Unable to write to \"%s\".\n\n", tmp_file);
+      error = 1;
+    }
+  }
+
+  /* Some systems do not let an existing file be replaced by renaming. */
+  if (error == 0 && rename (tmp_file, c->file) != 0
+      && (remove (c->file) != 0 || rename (tmp_file, c->file) != 0))
+  {
+    fprintf (stderr, "ERROR: Unable to write to \"%s\".\n\n", c->file);
+    error = 1;
+  }
+
+  free (tmp_file);
+
+  return error;
+}
@@ -0,0 +1,44 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the checkpoints of tournaments.
+*/
+
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+
+/* The progress of a round-robin tournament. */
+typedef struct checkpoint
+{
+  /* The path to the file holding the checkpoint. */
+  const char *file;
+
+  /* The warriors in the tournament. */
+  const warrior_t *entrants;
+  unsigned int num_entrants;
+
+  /* The number of battles between every pair of warriors, the seed for
+     placing them and whether it was given by the user, the step between
+     the offsets in a sweep, or 0, and whether the placements are spread
+     evenly. */
+  unsigned int num_rounds;
+  uint64_t seed;
+  bool seed_given;
+  unsigned int stride;
+  bool spread;
+
+  /* Whether all the battles of every pair of warriors, in the order of
+     the pairings of tourney_round_robin(), have been played, and the total
+     scores of either warrior of the pair in them if so. */
+  bool *done;
+  uint32_t (*totals)[2];
+} checkpoint_t;
+
+extern int checkpoint_read (checkpoint_t *c);
+
+extern int checkpoint_write (const checkpoint_t *c);
+
+#endif /* CHECKPOINT_H_INCLUDED */
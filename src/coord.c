@@ -0,0 +1,638 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The coordinator of worker processes. The battles of a tournament are
+  shared out among a number of worker processes, so that a warrior that
+  brings down the simulator or the assembler only takes a worker with it
+  and not the whole tournament.
+
+  Every worker is a copy of this process that runs a batch (see batch.c)
+  with the jobs read from a pipe and the results written to another one.
+  The unit of work is a pair of warriors, sent as a job playing all the
+  rounds of the pair, with the number of the pair as its ID. Since jobs and
+  results are lines of text, the same protocol works with any process that
+  runs a batch, such as a server on another machine (see serve.c).
+
+  A few jobs are kept outstanding with every worker, so that a worker does
+  not sit idle while its results travel back. If a worker dies, its
+  outstanding jobs are handed to the other workers and a new worker takes
+  its place. Once there are no more jobs to hand out, an idle worker also
+  takes a copy of a job that another worker is still busy with, so that a
+  slow worker does not hold up the whole tournament, and the first result
+  for a job is the one kept.
+*/
+
+/* Processes, pipes and signals are not part of C99. */
+#if defined (__unix__) || defined (__APPLE__)
+#define ZINC_WORKERS
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ZINC_WORKERS
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "zinc.h"
+#include "mars.h"
+#include "tourney.h"
+#include "batch.h"
+#include "coord.h"
+
+/* The number of jobs kept outstanding with every worker. */
+#define COORD_DEPTH 4U
+
+/* The number of workers a job may bring down before the tournament is
+   given up. */
+#define COORD_ATTEMPTS 3U
+
+/* The maximum number of characters in a line of results. */
+#define MAX_RESULT_LINE_LEN 4096U
+
+#ifdef ZINC_WORKERS
+/* A worker process. */
+typedef struct worker
+{
+  /* The identifier of the process, or -1 if it is not running. */
+  pid_t pid;
+
+  /* The pipe the jobs are written to. */
+  int jobs;
+
+  /* The pipe the results are read from. */
+  int results;
+
+  /* The results read but not yet handled. */
+  char buf[MAX_RESULT_LINE_LEN];
+  size_t len;
+
+  /* The pairs whose jobs are outstanding with the worker. */
+  unsigned int pending[COORD_DEPTH];
+  unsigned int num_pending;
+} worker_t;
+
+/* The state of a tournament shared out among workers. */
+typedef struct coord
+{
+  /* The warriors taking part. */
+  const warrior_t *entrants;
+
+  /* The pairs of warriors that meet. */
+  const pairing_t *pairings;
+  unsigned int num_pairings;
+
+  /* The settings of every job. */
+  unsigned int num_rounds;
+  unsigned int num_threads;
+  uint64_t seed;
+  unsigned int stride;
+  bool spread;
+
+  /* The workers. */
+  worker_t *workers;
+  unsigned int num_workers;
+
+  /* The next pair never handed out. */
+  unsigned int next_pairing;
+
+  /* The pairs whose jobs must be handed out again, as a stack. */
+  unsigned int *retries;
+  unsigned int num_retries;
+
+  /* For every pair, the number of its jobs outstanding, the number of
+     workers it has brought down and whether its result is in. */
+  uint8_t *copies;
+  uint8_t *attempts;
+  bool *done;
+  unsigned int num_done;
+
+  /* The total scores of the warriors of every pair. */
+  uint32_t (*totals)[2];
+} coord_t;
+
+
+/* Starts the worker W for the tournament C. Returns 0 on success and 1 on
+   failure. */
+static int
+start_worker (coord_t *c, worker_t *w)
+{
+  int error = 0;
+  int jobs[2] = { -1, -1 }, results[2] = { -1, -1 };
+
+  w->len = 0U;
+  w->num_pending = 0U;
+  if (pipe (jobs) != 0 || pipe (results) != 0)
+  {
+    error = 1;
+  }
+  else
+  {
+    /* Output not yet written out would be written out twice. */
+    fflush (stdout);
+    fflush (stderr);
+    w->pid = fork ();
+    if (w->pid < 0)
+    {
+      error = 1;
+    }
+  }
+
+  if (error == 0 && w->pid == 0)
+  {
+    FILE *in = NULL, *out = NULL;
+    int status = 1;
+
+    /* The other workers must see the end of their jobs when the
+       coordinator closes its ends of their pipes. */
+    for (unsigned int i = 0U; i < c->num_workers; i++)
+    {
+      if (&c->workers[i] != w && c->workers[i].pid > 0)
+      {
+        close (c->workers[i].jobs);
+        close (c->workers[i].results);
+      }
+    }
+    close (jobs[1]);
+    close (results[0]);
+
+    in = fdopen (jobs[0], "r");
+    out = fdopen (results[1], "w");
+    if (in != NULL && out != NULL)
+    {
+      status = batch_run (in, out, c->num_rounds, c->num_threads, c->seed,
+                          c->stride, c->spread);
+      fflush (out);
+    }
+    _exit (status);
+  }
+
+  if (error == 0)
+  {
+    close (jobs[0]);
+    close (results[1]);
+    w->jobs = jobs[1];
+    w->results = results[0];
+  }
+  else
+  {
+    for (unsigned int i = 0U; i < 2U; i++)
+    {
+      if (jobs[i] >= 0)
+      {
+        close (jobs[i]);
+      }
+      if (results[i] >= 0)
+      {
+        close (results[i]);
+      }
+    }
+    w->pid = -1;
+    fprintf (stderr, "ERROR: Unable to start a worker process.\n\n");
+  }
+
+  return error;
+}
+
+
+/* Stops the worker W, killing it if KILL_IT is true and otherwise letting it
+   finish its jobs first. */
+static void
+stop_worker (worker_t *w, bool kill_it)
+{
+  if (w->pid > 0)
+  {
+    close (w->jobs);
+    if (kill_it == true)
+    {
+      kill (w->pid, SIGKILL);
+    }
+    close (w->results);
+    waitpid (w->pid, NULL, 0);
+  }
+  w->pid = -1;
+}
+
+
+/* Hands the worker W of the tournament C its next job, if there is one.
+   Returns 0 on success and 1 if the job could not be written out, in
+   which case the worker must be given up. */
+static int
+hand_out (coord_t *c, worker_t *w)
+{
+  int error = 0;
+  unsigned int k = c->num_pairings;
+
+  if (c->num_retries > 0U)
+  {
+    c->num_retries--;
+    k = c->retries[c->num_retries];
+  }
+  else if (c->next_pairing < c->num_pairings)
+  {
+    k = c->next_pairing;
+    c->next_pairing++;
+  }
+  else if (w->num_pending == 0U)
+  {
+    /* Copy a job that only one busy worker has. */
+    for (unsigned int i = 0U; k == c->num_pairings && i < c->num_workers;
+         i++)
+    {
+      for (unsigned int j = 0U; j < c->workers[i].num_pending; j++)
+      {
+        unsigned int p = c->workers[i].pending[j];
+
+        if (c->done[p] == false && c->copies[p] == 1U)
+        {
+          k = p;
+          break;
+        }
+      }
+    }
+  }
+
+  if (k < c->num_pairings)
+  {
+    const pairing_t *p = &c->pairings[k];
+    char *line = NULL;
+    int len = 0;
+    size_t size = strlen (c->entrants[p->first].file)
+                  + strlen (c->entrants[p->second].file) + 128U;
+
+    c->copies[k]++;
+    w->pending[w->num_pending] = k;
+    w->num_pending++;
+
+    line = (char *)malloc (size);
+    if (line == NULL)
+    {
+      error = 1;
+    }
+    else
+    {
+      len = snprintf (line, size, "id=%u rounds=%u seed=%" PRIu64
+                      " stride=%u spread=%u %s %s\n", k, c->num_rounds,
+                      c->seed, c->stride, (c->spread == true) ? 1U : 0U,
+                      c->entrants[p->first].file,
+                      c->entrants[p->second].file);
+    }
+
+    for (int sent = 0; error == 0 && sent < len;)
+    {
+      ssize_t n = write (w->jobs, line + sent, (size_t )(len - sent));
+
+      if (n > 0)
+      {
+        sent += (int )n;
+      }
+      else if (n < 0 && errno != EINTR)
+      {
+        error = 1;
+      }
+    }
+    free (line);
+  }
+
+  return error;
+}
+
+
+/* Gives up the worker W of the tournament C, which has died or failed,
+   handing its outstanding jobs to the other workers, and starts another
+   worker in its place. Returns 0 on success and 1 if the tournament must be
+   given up. */
+static int
+replace_worker (coord_t *c, worker_t *w)
+{
+  int error = 0;
+
+  stop_worker (w, true);
+
+  for (unsigned int i = 0U; i < w->num_pending; i++)
+  {
+    unsigned int k = w->pending[i];
+
+    c->copies[k]--;
+    if (c->done[k] == false && c->copies[k] == 0U)
+    {
+      c->attempts[k]++;
+      if (c->attempts[k] >= COORD_ATTEMPTS)
+      {
+        fprintf (stderr, "ERROR: The battles between \"%s\" and \"%s\" "
+                 "brought down %u worker processes.\n\n",
+                 c->entrants[c->pairings[k].first].name,
+                 c->entrants[c->pairings[k].second].name, COORD_ATTEMPTS);
+        error = 1;
+      }
+      c->retries[c->num_retries] = k;
+      c->num_retries++;
+    }
+  }
+  w->num_pending = 0U;
+
+  if (error == 0)
+  {
+    error = start_worker (c, w);
+  }
+
+  return error;
+}
+
+
+/* Handles the line of results LINE from the worker W of the tournament C.
+   Returns 0 on success, 1 if the line does not hold the results of a job
+   outstanding with W and 2 if the job failed. */
+static int
+handle_result (coord_t *c, worker_t *w, const char *line)
+{
+  int error = 0;
+  unsigned int k = 0U, i = 0U;
+  uint32_t totals[2] = { 0U, 0U };
+  const char *scores = strstr (line, ",\"scores\":[");
+
+  if (sscanf (line, "{\"id\":\"%u\"", &k) != 1)
+  {
+    error = 1;
+  }
+
+  while (error == 0 && i < w->num_pending && w->pending[i] != k)
+  {
+    i++;
+  }
+
+  if (error == 0 && i == w->num_pending)
+  {
+    error = 1;
+  }
+  else if (error == 0 && (scores == NULL
+                          || sscanf (scores, ",\"scores\":[%" SCNu32 ",%"
+                                     SCNu32 "]", &totals[0], &totals[1])
+                             != 2))
+  {
+    fprintf (stderr, "ERROR: The battles between \"%s\" and \"%s\" "
+             "failed: %s\n\n", c->entrants[c->pairings[k].first].name,
+             c->entrants[c->pairings[k].second].name, line);
+    error = 2;
+  }
+
+  if (error != 1)
+  {
+    w->num_pending--;
+    w->pending[i] = w->pending[w->num_pending];
+    c->copies[k]--;
+  }
+
+  if (error == 0 && c->done[k] == false)
+  {
+    c->totals[k][0] = totals[0];
+    c->totals[k][1] = totals[1];
+    c->done[k] = true;
+    c->num_done++;
+  }
+
+  return error;
+}
+
+
+/* Reads the results waiting on the pipe of the worker W of the tournament
+   C and handles every complete line of them. Returns 0 on success, 1 if
+   the worker has died or failed and 2 if the tournament must be given
+   up. */
+static int
+read_results (coord_t *c, worker_t *w)
+{
+  int error = 0;
+  ssize_t n = read (w->results, w->buf + w->len, sizeof (w->buf) - w->len);
+
+  if (n <= 0)
+  {
+    error = (n < 0 && errno == EINTR) ? 0 : 1;
+  }
+  else
+  {
+    char *start = w->buf, *end = NULL;
+
+    w->len += (size_t )n;
+    while (error == 0
+           && (end = memchr (start, '\n', w->len - (start - w->buf)))
+              != NULL)
+    {
+      *end = '\0';
+      error = handle_result (c, w, start);
+      start = end + 1;
+    }
+
+    w->len -= (size_t )(start - w->buf);
+    memmove (w->buf, start, w->len);
+    if (w->len == sizeof (w->buf))
+    {
+      error = 1;
+    }
+  }
+
+  return error;
+}
+
+
+/* Plays the tournament C on its workers. Returns 0 on success and 1 on
+   failure. */
+static int
+coord_run (coord_t *c)
+{
+  int error = 0;
+  struct pollfd *fds
+    = (struct pollfd *)malloc (c->num_workers * sizeof (struct pollfd));
+
+  if (fds == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for workers.\n\n");
+    error = 1;
+  }
+
+  for (unsigned int i = 0U; error == 0 && i < c->num_workers; i++)
+  {
+    error = start_worker (c, &c->workers[i]);
+  }
+
+  while (error == 0 && c->num_done < c->num_pairings)
+  {
+    for (unsigned int i = 0U; error == 0 && i < c->num_workers; i++)
+    {
+      worker_t *w = &c->workers[i];
+      unsigned int before = COORD_DEPTH;
+
+      while (error == 0 && w->num_pending < COORD_DEPTH
+             && w->num_pending != before)
+      {
+        before = w->num_pending;
+        if (hand_out (c, w) != 0)
+        {
+          error = replace_worker (c, w);
+        }
+      }
+
+      fds[i].fd = w->results;
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+
+    if (error == 0 && poll (fds, c->num_workers, -1) < 0 && errno != EINTR)
+    {
+      fprintf (stderr, "ERROR: Unable to wait for the worker "
+               "processes.\n\n");
+      error = 1;
+    }
+
+    for (unsigned int i = 0U; error == 0 && i < c->num_workers; i++)
+    {
+      if (fds[i].revents != 0)
+      {
+        int status = read_results (c, &c->workers[i]);
+
+        if (status == 1)
+        {
+          error = replace_worker (c, &c->workers[i]);
+        }
+        else if (status != 0)
+        {
+          error = 1;
+        }
+      }
+    }
+  }
+
+  /* A worker still busy with a copy of a job is not waited for. */
+  for (unsigned int i = 0U; i < c->num_workers; i++)
+  {
+    stop_worker (&c->workers[i], c->workers[i].num_pending > 0U
+                                 || error != 0);
+  }
+  free (fds);
+
+  return error;
+}
+#endif
+
+
+/* Plays NUM_ROUNDS battles for every one of the NUM_PAIRINGS pairs of
+   warriors in PAIRINGS, which refer to the warriors in ENTRANTS, like
+   tourney_play(), but on NUM_WORKERS worker processes, each running up to
+   NUM_THREADS battles at once. The warriors are assembled again by the
+   workers from their files. The total scores of the two warriors of every
+   pair are stored in TOTALS. Returns 0 on success and 1 on failure. */
+int
+coord_play (const warrior_t *entrants, const pairing_t *pairings,
+            unsigned int num_pairings, unsigned int num_rounds,
+            unsigned int num_workers, unsigned int num_threads,
+            uint64_t seed, unsigned int stride, bool spread,
+            uint32_t (*totals)[2])
+{
+  int error = 0;
+
+#ifdef ZINC_WORKERS
+  coord_t c;
+  struct sigaction action, old_action;
+
+  c.entrants = entrants;
+  c.pairings = pairings;
+  c.num_pairings = num_pairings;
+  c.num_rounds = num_rounds;
+  c.num_threads = num_threads;
+  c.seed = seed;
+  c.stride = stride;
+  c.spread = spread;
+  c.num_workers = (num_workers < num_pairings) ? num_workers : num_pairings;
+  c.next_pairing = 0U;
+  c.num_retries = 0U;
+  c.num_done = 0U;
+  c.totals = totals;
+  c.workers = (worker_t *)calloc (c.num_workers, sizeof (worker_t));
+  c.retries = (unsigned int *)malloc (num_pairings * sizeof (unsigned int));
+  c.copies = (uint8_t *)calloc (num_pairings, sizeof (uint8_t));
+  c.attempts = (uint8_t *)calloc (num_pairings, sizeof (uint8_t));
+  c.done = (bool *)calloc (num_pairings, sizeof (bool));
+
+  if (c.workers == NULL || c.retries == NULL || c.copies == NULL
+      || c.attempts == NULL || c.done == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for workers.\n\n");
+    error = 1;
+  }
+
+  /* The jobs name the files of the warriors in words separated by
+     blanks. */
+  for (unsigned int i = 0U; error == 0 && i < num_pairings; i++)
+  {
+    const char *files[2] = { entrants[pairings[i].first].file,
+                             entrants[pairings[i].second].file };
+
+    for (unsigned int j = 0U; error == 0 && j < 2U; j++)
+    {
+      if (files[j] == NULL || files[j][0] == '\0'
+          || strpbrk (files[j], " \t\r\n") != NULL
+          || strchr (files[j], '=') != NULL)
+      {
+        fprintf (stderr, "ERROR: The file \"%s\" cannot be named in a job "
+                 "for a worker process.\n\n",
+                 (files[j] != NULL) ? files[j] : "");
+        error = 1;
+      }
+    }
+  }
+
+  if (error == 0)
+  {
+    for (unsigned int i = 0U; i < c.num_workers; i++)
+    {
+      c.workers[i].pid = -1;
+    }
+
+    /* Writing to a worker that has died must fail instead of killing the
+       coordinator. */
+    memset (&action, 0, sizeof (action));
+    sigemptyset (&action.sa_mask);
+    action.sa_handler = SIG_IGN;
+    sigaction (SIGPIPE, &action, &old_action);
+
+    error = coord_run (&c);
+
+    sigaction (SIGPIPE, &old_action, NULL);
+  }
+
+  free (c.workers);
+  free (c.retries);
+  free (c.copies);
+  free (c.attempts);
+  free (c.done);
+#else
+  (void )entrants;
+  (void )pairings;
+  (void )num_pairings;
+  (void )num_rounds;
+  (void )num_workers;
+  (void )num_threads;
+  (void )seed;
+  (void )stride;
+  (void )spread;
+  (void )totals;
+  fprintf (stderr, "ERROR: This build of ZINC cannot use worker "
+           "processes.\n\n");
+  error = 1;
+#endif
+
+  return error;
+}
@@ -0,0 +1,23 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the coordinator of worker processes.
+*/
+
+#ifndef COORD_H_INCLUDED
+#define COORD_H_INCLUDED
+
+/* The maximum number of worker processes. */
+#define MAX_WORKERS 256U
+
+extern int
+coord_play (const warrior_t *entrants, const pairing_t *pairings,
+            unsigned int num_pairings, unsigned int num_rounds,
+            unsigned int num_workers, unsigned int num_threads,
+            uint64_t seed, unsigned int stride, bool spread,
+            uint32_t (*totals)[2]);
+
+#endif /* COORD_H_INCLUDED */
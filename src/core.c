@@ -0,0 +1,138 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The layout and allocation of the core.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zinc.h"
+#include "mars.h"
+#include "core.h"
+
+/* The number of cells allocated for the core, including its mirror
+   image. */
+#ifdef ZINC_MIRRORED_CORE
+#define NUM_ALLOC_CELLS (2U * core_size)
+#else
+#define NUM_ALLOC_CELLS core_size
+#endif
+
+
+/* Allocates the memory for the core of the simulator M, along with its
+   mirror image if ZINC_MIRRORED_CORE is defined. Returns 0 on success and 1
+   on failure. */
+int
+alloc_core (mars_t *m)
+{
+  int error = 0;
+
+#ifdef ZINC_SPLIT_CORE
+  m->core_op_a
+    = (cell_addr_t *)malloc (NUM_ALLOC_CELLS * sizeof (cell_addr_t));
+  m->core_op_b
+    = (cell_addr_t *)malloc (NUM_ALLOC_CELLS * sizeof (cell_addr_t));
+  m->core_insn = (uint8_t *)malloc (NUM_ALLOC_CELLS * sizeof (uint8_t));
+  if (opt_no_gui == false)
+  {
+    m->core_marker
+      = (warrior_id_t *)malloc (core_size * sizeof (warrior_id_t));
+  }
+
+  if (m->core_op_a == NULL || m->core_op_b == NULL || m->core_insn == NULL
+      || (opt_no_gui == false && m->core_marker == NULL))
+  {
+    error = 1;
+  }
+#else
+  m->core = (cell_t *)malloc (NUM_ALLOC_CELLS * sizeof (cell_t));
+  if (m->core == NULL)
+  {
+    error = 1;
+  }
+#endif
+
+  return error;
+}
+
+
+/* Frees the memory for the core of the simulator M. */
+void
+free_core (mars_t *m)
+{
+#ifdef ZINC_SPLIT_CORE
+  free (m->core_op_a);
+  free (m->core_op_b);
+  free (m->core_insn);
+  free (m->core_marker);
+  m->core_op_a = m->core_op_b = NULL;
+  m->core_insn = NULL;
+  m->core_marker = NULL;
+#else
+  free (m->core);
+  m->core = NULL;
+#endif
+}
+
+
+/* Sets all the cells of the core of the simulator M to "DAT #0" and clears
+   their markers. The mirror image of the core, if any, is left alone. */
+void
+clear_core (mars_t *m)
+{
+  /* Both OP_DAT and MODE_IMMEDIATE have the value 0, so clearing a cell
+     to all zeroes sets it to "DAT #0". */
+#ifdef ZINC_SPLIT_CORE
+  memset (m->core_op_a, 0, core_size * sizeof (cell_addr_t));
+  memset (m->core_op_b, 0, core_size * sizeof (cell_addr_t));
+  memset (m->core_insn, 0, core_size * sizeof (uint8_t));
+  if (m->core_marker != NULL)
+  {
+    memset (m->core_marker, 0, core_size * sizeof (warrior_id_t));
+  }
+#else
+  memset (m->core, 0, core_size * sizeof (cell_t));
+#endif
+}
+
+
+/* Brings the mirror image of the core of the simulator M, if any, up to
+   date with the whole of the core. */
+void
+mirror_core (mars_t *m)
+{
+#ifdef ZINC_MIRRORED_CORE
+#ifdef ZINC_SPLIT_CORE
+  memcpy (m->core_op_a + core_size, m->core_op_a,
+          core_size * sizeof (cell_addr_t));
+  memcpy (m->core_op_b + core_size, m->core_op_b,
+          core_size * sizeof (cell_addr_t));
+  memcpy (m->core_insn + core_size, m->core_insn,
+          core_size * sizeof (uint8_t));
+#else
+  memcpy (m->core + core_size, m->core, core_size * sizeof (cell_t));
+#endif
+#endif
+}
+
+
+/* Copies the contents of the cell at ADDR in the core of the simulator M
+   into CELL. */
+void
+read_cell (const mars_t *m, cell_addr_t addr, cell_t *cell)
+{
+  cell->marker
+    = (opt_no_gui == false) ? CELL_MARKER (m, addr) : UNKNOWN_WARRIOR;
+  cell->op_code = CELL_OP_CODE (m, addr);
+  cell->mode_a = CELL_MODE_A (m, addr);
+  cell->mode_b = CELL_MODE_B (m, addr);
+  cell->op_a = CELL_OP_A (m, addr);
+  cell->op_b = CELL_OP_B (m, addr);
+}
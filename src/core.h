@@ -0,0 +1,113 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The layout and allocation of the core.
+*/
+
+#ifndef CORE_H_INCLUDED
+#define CORE_H_INCLUDED
+
+/* If ZINC_SPLIT_CORE is defined, the fields of the cells are kept in
+   separate arrays instead of an array of cell_t, so that instructions that
+   only look at the B-fields of cells touch fewer cache lines:
+
+     CORE_OP_A, CORE_OP_B - the operands of the cells;
+     CORE_INSN            - the opcodes and addressing modes of the cells,
+                            packed together as described for PACK_INSN;
+     CORE_MARKER          - the markers of the cells, which are only kept
+                            for the GUI and are not allocated at all if it
+                            is not shown.
+
+   The cells of the core of a simulator M should only be accessed using the
+   macros below, which work with either layout. */
+#ifdef ZINC_SPLIT_CORE
+
+/* Packs the opcode OP and the addressing modes MA and MB of an instruction
+   into a byte. All of them being 0 stands for "DAT #0". */
+#define PACK_INSN(op, ma, mb) \
+  ((uint8_t )(((op) << 4) | ((ma) << 2) | (mb)))
+
+#define CELL_OP_CODE(m, addr) ((m)->core_insn[(addr)] >> 4)
+#define CELL_MODE_A(m, addr) (((m)->core_insn[(addr)] >> 2) & 0x03U)
+#define CELL_MODE_B(m, addr) ((m)->core_insn[(addr)] & 0x03U)
+#define CELL_OP_A(m, addr) (m)->core_op_a[(addr)]
+#define CELL_OP_B(m, addr) (m)->core_op_b[(addr)]
+#define CELL_MARKER(m, addr) (m)->core_marker[(addr)]
+
+/* Sets the opcode of the cell at ADDR to OP and its addressing modes to MA
+   and MB. */
+#define SET_CELL_INSN(m, addr, op, ma, mb) \
+  (m)->core_insn[(addr)] = PACK_INSN ((op), (ma), (mb))
+
+/* Copies the instruction in the cell at FROM into the cell at TO. The
+   marker of the cell is not copied. */
+#define COPY_CELL(m, to, from) \
+  do \
+  { \
+    (m)->core_insn[(to)] = (m)->core_insn[(from)]; \
+    (m)->core_op_a[(to)] = (m)->core_op_a[(from)]; \
+    (m)->core_op_b[(to)] = (m)->core_op_b[(from)]; \
+  } while (0)
+
+#else
+
+#define CELL_OP_CODE(m, addr) (m)->core[(addr)].op_code
+#define CELL_MODE_A(m, addr) (m)->core[(addr)].mode_a
+#define CELL_MODE_B(m, addr) (m)->core[(addr)].mode_b
+#define CELL_OP_A(m, addr) (m)->core[(addr)].op_a
+#define CELL_OP_B(m, addr) (m)->core[(addr)].op_b
+#define CELL_MARKER(m, addr) (m)->core[(addr)].marker
+
+#define SET_CELL_INSN(m, addr, op, ma, mb) \
+  do \
+  { \
+    (m)->core[(addr)].op_code = (op); \
+    (m)->core[(addr)].mode_a = (ma); \
+    (m)->core[(addr)].mode_b = (mb); \
+  } while (0)
+
+#define COPY_CELL(m, to, from) (m)->core[(to)] = (m)->core[(from)]
+
+#endif
+
+/* Sets the marker of the cell at ADDR to the warrior identifier ID. Markers
+   are only needed by the GUI, so this does nothing if it is not shown. */
+#define MARK_CELL(m, addr, id) \
+  do \
+  { \
+    if (opt_no_gui == false) \
+    { \
+      CELL_MARKER ((m), (addr)) = (id); \
+    } \
+  } while (0)
+
+/* If ZINC_MIRRORED_CORE is defined, the core is followed by a mirror image
+   of itself, so that the cell at ADDR can also be accessed as the cell at
+   ADDR + CORE_SIZE. This lets the sum of two addresses in the core be used
+   as an index without normalising it first. Markers are not mirrored. */
+#ifdef ZINC_MIRRORED_CORE
+
+/* Copies the cell at ADDR into the mirror image of the core. This must be
+   done every time the cell is modified. */
+#define MIRROR_CELL(m, addr) COPY_CELL ((m), (addr) + core_size, (addr))
+
+#else
+
+#define MIRROR_CELL(m, addr) do { } while (0)
+
+#endif
+
+extern int alloc_core (mars_t *m);
+
+extern void free_core (mars_t *m);
+
+extern void clear_core (mars_t *m);
+
+extern void mirror_core (mars_t *m);
+
+extern void read_cell (const mars_t *m, cell_addr_t addr, cell_t *cell);
+
+#endif /* CORE_H_INCLUDED */
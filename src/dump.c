@@ -11,6 +11,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "zinc.h"
 #include "dump.h"
@@ -63,7 +64,7 @@ static char *mode_markers[] = { "#", "$", "@"};
 
 /* Dumps an instruction at the cell C into the buffer BUF. */
 void
-dump_insn (char *buf, size_t buf_size, cell_t *c)
+dump_insn (char *buf, size_t buf_size, const cell_t *c)
 {
   snprintf (buf, buf_size, "%s", insn_mnemonics[c->op_code]);
   buf[buf_size - 1] = '\0';
@@ -98,35 +99,64 @@ dump_insn (char *buf, size_t buf_size, cell_t *c)
 }
 
 
-/* Dumps the warrior programme W to standard output. */
-void
-dump_warrior (warrior_t *w)
+/* Returns true if the string S can be given to a descriptive assembler
+   directive, that is, if it is short enough and only has the characters
+   allowed in a string. */
+static bool
+is_plain_string (const char *s)
 {
-  printf (";\n; Name:    %s\n", w->name);
+  size_t len = strlen (s);
+  bool plain = (len <= MAX_STR_IDENT_LEN);
 
-  if (w->version != NULL)
+  for (size_t i = 0U; plain == true && i < len; i++)
   {
-    printf ("; Version: %s\n", w->version);
+    plain = (isalnum ((unsigned char )s[i]) || s[i] == '_' || s[i] == '.'
+             || s[i] == '@' || s[i] == '\'' || s[i] == ' ');
   }
 
-  if (w->author != NULL)
+  return plain;
+}
+
+
+/* Dumps the descriptive string S, if any, to OUT as the descriptive
+   assembler directive DIRECTIVE if it can be read back, or as a comment
+   with the label LABEL otherwise. */
+static void
+dump_descr (FILE *out, const char *directive, const char *label,
+            const char *s)
+{
+  if (s != NULL && is_plain_string (s))
   {
-    printf ("; Author:  %s\n", w->author);
+    fprintf (out, "  %s \"%s\"\n", directive, s);
   }
+  else if (s != NULL)
+  {
+    fprintf (out, "; %-8s %s\n", label, s);
+  }
+}
+
 
-  printf (";\n");
+/* Dumps the warrior programme W to OUT as a programme that the assembler
+   reads back into the same instructions. */
+void
+dump_warrior (FILE *out, const warrior_t *w)
+{
+  dump_descr (out, "NAM", "Name:", w->name);
+  dump_descr (out, "VER", "Version:", w->version);
+  dump_descr (out, "AUT", "Author:", w->author);
+  fprintf (out, "\n  ORG START\n\n");
 
   for (unsigned int i = 0U; i < w->num_insns; i++)
   {
     if (i == w->init_pc)
     {
-      printf ("START:\n");
+      fprintf (out, "START:\n");
     }
 
     char tmp_buf[TMP_BUF_SIZE];
     dump_insn (tmp_buf, TMP_BUF_SIZE, w->insns + i);
-    printf ("  %-20s ; %u\n", tmp_buf, i);
+    fprintf (out, "  %-20s ; %u\n", tmp_buf, i);
   }
 
-  printf ("\n");
+  fprintf (out, "\n");
 }
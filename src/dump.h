@@ -10,7 +10,7 @@
 #ifndef DUMP_H_INCLUDED
 #define DUMP_H_INCLUDED
 
-extern void dump_insn (char *buf, size_t buf_size, cell_t *c);
-extern void dump_warrior (warrior_t *w);
+extern void dump_insn (char *buf, size_t buf_size, const cell_t *c);
+extern void dump_warrior (FILE *out, const warrior_t *w);
 
 #endif /* DUMP_H_INCLUDED */
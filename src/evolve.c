@@ -0,0 +1,541 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The evolution of warriors. A population of warriors descended from the
+  first warrior is kept in memory as assembled instructions. Every
+  generation, the warriors with the highest total scores against the other
+  warriors (the benchmark) survive and the rest of the population is
+  replaced by offspring of the survivors, which are copies of them with a
+  few instructions, addressing modes, operands or the starting offset
+  changed at random. The offspring only ever hold instructions that the
+  assembler would accept, so the survivors of the last generation can be
+  written out as programmes.
+
+  The mutations come from a random number generator of their own, seeded
+  with the seed for placing the warriors, and every warrior plays the
+  benchmark with the same placements, so an evolution can be repeated
+  exactly and its warriors are compared on an equal footing.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zinc.h"
+#include "mars.h"
+#include "dump.h"
+#include "tourney.h"
+#include "evolve.h"
+
+/* The number of warriors in the population and the number of them that
+   survive into the next generation. */
+#define EVOLVE_POPULATION 32U
+#define EVOLVE_SURVIVORS 8U
+
+/* The most mutations made in an offspring. */
+#define EVOLVE_MUTATIONS 3U
+
+/* The farthest that an operand changed at random refers to from its
+   instruction, when it does not take any value at all. */
+#define EVOLVE_REACH 32
+
+/* The maximum number of characters in the name of an evolved warrior. */
+#define MAX_EVOLVED_NAME_LEN 127U
+
+/* The number of addressing modes. */
+#define NUM_MODES 3U
+
+/* The kinds of operand that an instruction takes, as in the assembler. */
+typedef enum
+{
+  OPERAND_NONE,
+  OPERAND_IMMEDIATE,
+  OPERAND_ADDRESS,
+  OPERAND_ANY,
+} operand_t;
+
+/* The kinds of operands A and B taken by every instruction. The order has
+   to remain the same as that of the operation codes in zinc.h. */
+static const operand_t insn_operands[][2] =
+{
+  { OPERAND_NONE, OPERAND_IMMEDIATE }, /* DAT */
+  { OPERAND_ANY, OPERAND_ADDRESS },    /* MOV */
+  { OPERAND_ANY, OPERAND_ADDRESS },    /* ADD */
+  { OPERAND_ANY, OPERAND_ADDRESS },    /* SUB */
+  { OPERAND_ANY, OPERAND_ADDRESS },    /* MUL */
+  { OPERAND_ANY, OPERAND_ADDRESS },    /* DIV */
+  { OPERAND_ANY, OPERAND_ADDRESS },    /* MOD */
+  { OPERAND_NONE, OPERAND_ADDRESS },   /* JMP */
+  { OPERAND_ANY, OPERAND_ADDRESS },    /* JMZ */
+  { OPERAND_ANY, OPERAND_ADDRESS },    /* JMN */
+  { OPERAND_ANY, OPERAND_ANY },        /* SKL */
+  { OPERAND_ANY, OPERAND_ANY },        /* SKE */
+  { OPERAND_ANY, OPERAND_ANY },        /* SKN */
+  { OPERAND_ANY, OPERAND_ANY },        /* SKG */
+  { OPERAND_NONE, OPERAND_ADDRESS },   /* SPL */
+};
+
+/* The number of operation codes. */
+#define NUM_OP_CODES (sizeof (insn_operands) / sizeof (insn_operands[0]))
+
+
+/* Makes the operand OP with the addressing mode MODE one of the kind KIND,
+   as the assembler would have it. */
+static void
+fit_operand (unsigned char *mode, cell_addr_t *op, operand_t kind)
+{
+  if (kind == OPERAND_NONE)
+  {
+    *mode = MODE_IMMEDIATE;
+    *op = 0U;
+  }
+  else if (kind == OPERAND_IMMEDIATE)
+  {
+    *mode = MODE_IMMEDIATE;
+  }
+  else if (kind == OPERAND_ADDRESS && *mode == MODE_IMMEDIATE)
+  {
+    *mode = MODE_DIRECT;
+  }
+}
+
+
+/* Makes the instruction C one that the assembler accepts. */
+static void
+fit_insn (cell_t *c)
+{
+  fit_operand (&c->mode_a, &c->op_a, insn_operands[c->op_code][0]);
+  fit_operand (&c->mode_b, &c->op_b, insn_operands[c->op_code][1]);
+}
+
+
+/* Returns a random operand from the random number generator with the
+   state RNG, either any value at all or one near its instruction. */
+static cell_addr_t
+random_operand (uint64_t *rng)
+{
+  cell_addr_t op;
+
+  if ((rng_next (rng) & 1U) == 0U)
+  {
+    op = (cell_addr_t )(rng_next (rng) % core_size);
+  }
+  else
+  {
+    op = normalise ((int32_t )(rng_next (rng) % (2U * EVOLVE_REACH + 1U))
+                    - EVOLVE_REACH);
+  }
+
+  return op;
+}
+
+
+/* Makes a random change to the warrior W, which has room for as many
+   instructions as a programme can have, with the random number generator
+   with the state RNG. */
+static void
+mutate (warrior_t *w, uint64_t *rng)
+{
+  unsigned int i = rng_next (rng) % w->num_insns;
+  cell_t *c = &w->insns[i];
+
+  switch (rng_next (rng) % 8U)
+  {
+  case 0:
+    c->op_code = (unsigned char )(rng_next (rng) % NUM_OP_CODES);
+    break;
+
+  case 1:
+    c->mode_a = (unsigned char )(rng_next (rng) % NUM_MODES);
+    break;
+
+  case 2:
+    c->mode_b = (unsigned char )(rng_next (rng) % NUM_MODES);
+    break;
+
+  case 3:
+    c->op_a = random_operand (rng);
+    break;
+
+  case 4:
+    c->op_b = random_operand (rng);
+    break;
+
+  case 5:
+    /* Insert a random instruction before the I-th one. */
+    if (w->num_insns < max_prog_insns)
+    {
+      memmove (c + 1, c, (w->num_insns - i) * sizeof (cell_t));
+      c->op_code = (unsigned char )(rng_next (rng) % NUM_OP_CODES);
+      c->mode_a = (unsigned char )(rng_next (rng) % NUM_MODES);
+      c->mode_b = (unsigned char )(rng_next (rng) % NUM_MODES);
+      c->op_a = random_operand (rng);
+      c->op_b = random_operand (rng);
+      w->num_insns++;
+      if (w->init_pc >= i)
+      {
+        w->init_pc++;
+      }
+    }
+    break;
+
+  case 6:
+    /* Delete the I-th instruction. */
+    if (w->num_insns > 1U)
+    {
+      memmove (c, c + 1, (w->num_insns - i - 1U) * sizeof (cell_t));
+      w->num_insns--;
+      if (w->init_pc > i)
+      {
+        w->init_pc--;
+      }
+      else if (w->init_pc >= w->num_insns)
+      {
+        w->init_pc = 0U;
+      }
+      c = NULL;
+    }
+    break;
+
+  default:
+    w->init_pc = (cell_addr_t )i;
+    break;
+  }
+
+  if (c != NULL)
+  {
+    fit_insn (c);
+  }
+}
+
+
+/* Plays NUM_ROUNDS battles between every one of the NUM_CANDIDATES
+   warriors starting at CANDIDATES, which is part of ENTRANTS, and every
+   one of the NUM_BENCH warriors at the start of ENTRANTS, with the
+   placements given by SEED, STRIDE and SPREAD, running up to NUM_THREADS
+   of them at once, and sets the total score of every candidate against
+   the benchmark in TOTALS. PAIRINGS and SCORES have room for the battles
+   of the whole population. Returns 0 on success and 1 on failure. */
+static int
+score_candidates (const warrior_t *entrants, unsigned int num_bench,
+                  unsigned int candidates, unsigned int num_candidates,
+                  unsigned int num_rounds, unsigned int num_threads,
+                  uint64_t seed, unsigned int stride, bool spread,
+                  pairing_t *pairings, uint32_t (*scores)[2],
+                  uint32_t *totals)
+{
+  int error = 0;
+  uint64_t num_battles = (uint64_t )num_candidates * num_bench * num_rounds;
+
+  for (unsigned int c = 0U; c < num_candidates; c++)
+  {
+    for (unsigned int b = 0U; b < num_bench; b++)
+    {
+      pairings[c * num_bench + b].first = candidates + c;
+      pairings[c * num_bench + b].second = b;
+    }
+  }
+
+  error = tourney_play (entrants, pairings, num_candidates * num_bench,
+                        num_rounds, num_threads, seed, stride, spread,
+                        scores);
+
+  for (unsigned int c = 0U; error == 0 && c < num_candidates; c++)
+  {
+    totals[c] = 0U;
+  }
+  for (uint64_t n = 0U; error == 0 && n < num_battles; n++)
+  {
+    totals[n / ((uint64_t )num_bench * num_rounds)] += scores[n][0];
+  }
+
+  return error;
+}
+
+
+/* Sorts the NUM warriors in POP, along with their total scores in TOTALS
+   and the generations they were born in in BORN, by their total scores
+   from the highest down, keeping warriors with the same score in the same
+   order. */
+static void
+sort_population (warrior_t *pop, uint32_t *totals, unsigned int *born,
+                 unsigned int num)
+{
+  for (unsigned int i = 1U; i < num; i++)
+  {
+    warrior_t w = pop[i];
+    uint32_t total = totals[i];
+    unsigned int b = born[i];
+    unsigned int j = i;
+
+    while (j > 0U && totals[j - 1U] < total)
+    {
+      pop[j] = pop[j - 1U];
+      totals[j] = totals[j - 1U];
+      born[j] = born[j - 1U];
+      j--;
+    }
+
+    pop[j] = w;
+    totals[j] = total;
+    born[j] = b;
+  }
+}
+
+
+/* Writes the survivors of an evolution, the first EVOLVE_SURVIVORS
+   warriors in POP, out as programmes in the folder OUT_DIR, or to the
+   standard output if OUT_DIR is NULL. Returns 0 on success and 1 on
+   failure. */
+static int
+write_survivors (const warrior_t *pop, const char *out_dir)
+{
+  int error = 0;
+  char *file = NULL;
+
+  if (out_dir != NULL)
+  {
+    file = (char *)malloc (strlen (out_dir) + 32U);
+    if (file == NULL)
+    {
+      fprintf (stderr, "ERROR: Unable to allocate memory for the "
+               "survivors.\n\n");
+      error = 1;
+    }
+  }
+
+  for (unsigned int i = 0U; error == 0 && i < EVOLVE_SURVIVORS; i++)
+  {
+    if (out_dir == NULL)
+    {
+      dump_warrior (stdout, &pop[i]);
+    }
+    else
+    {
+      sprintf (file, "%s/evolved-%u.zinc", out_dir, i + 1U);
+
+      FILE *out = fopen (file, "w");
+
+      if (out == NULL)
+      {
+        fprintf (stderr, "ERROR: Unable to write to \"%s\".\n\n", file);
+        error = 1;
+      }
+      else
+      {
+        dump_warrior (out, &pop[i]);
+        if (fclose (out) != 0)
+        {
+          fprintf (stderr, "ERROR: Unable to write to \"%s\".\n\n", file);
+          error = 1;
+        }
+        else
+        {
+          printf ("Wrote \"%s\".\n", file);
+        }
+      }
+    }
+  }
+
+  free (file);
+
+  return error;
+}
+
+
+/* Evolves the first of the NUM_WARRIORS warriors in WARRIORS for
+   NUM_GENERATIONS generations against the other warriors, playing
+   NUM_ROUNDS battles between every warrior in the population and every
+   other warrior, running up to NUM_THREADS of them at once with the
+   placements given by SEED, STRIDE and SPREAD as for
+   tourney_round_robin(). The progress of the evolution is printed out and
+   the survivors of the last generation are written out as programmes in
+   the folder OUT_DIR, or to the standard output if OUT_DIR is NULL.
+   Returns 0 on success and 1 on failure. */
+int
+evolve_run (const warrior_t *warriors, unsigned int num_warriors,
+            unsigned int num_generations, unsigned int num_rounds,
+            unsigned int num_threads, uint64_t seed, unsigned int stride,
+            bool spread, const char *out_dir)
+{
+  int error = 0;
+  unsigned int num_bench = num_warriors - 1U;
+  warrior_t *entrants = NULL;
+  warrior_t *pop = NULL;
+  char (*names)[MAX_EVOLVED_NAME_LEN + 1U] = NULL;
+  cell_t *insns = NULL;
+  pairing_t *pairings = NULL;
+  uint32_t (*scores)[2] = NULL;
+  uint32_t totals[EVOLVE_POPULATION];
+  unsigned int born[EVOLVE_POPULATION];
+
+  /* The mutations are kept apart from the sequences of the placements,
+     which start from the seed itself. */
+  uint64_t rng = ~seed;
+
+  if (stride != 0U)
+  {
+    num_rounds = tourney_sweep_rounds (stride);
+  }
+
+  if (num_warriors < 2U)
+  {
+    fprintf (stderr, "ERROR: An evolution needs a warrior and at least one "
+             "other to play.\n\n");
+    error = 1;
+  }
+  else if ((uint64_t )EVOLVE_POPULATION * num_bench * num_rounds
+           > UINT32_MAX)
+  {
+    fprintf (stderr, "ERROR: Too many battles in a generation.\n\n");
+    error = 1;
+  }
+  else if (num_rounds == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small for a sweep.\n\n");
+    error = 1;
+  }
+  else if (spread == true && tourney_sweep_rounds (1U) == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small to spread the "
+             "placements.\n\n");
+    error = 1;
+  }
+
+  if (error == 0)
+  {
+    entrants = (warrior_t *)malloc ((num_bench + EVOLVE_POPULATION)
+                                    * sizeof (warrior_t));
+    names = (char (*)[MAX_EVOLVED_NAME_LEN + 1U])
+            malloc (EVOLVE_POPULATION * sizeof (*names));
+    insns = (cell_t *)malloc (EVOLVE_POPULATION * max_prog_insns
+                              * sizeof (cell_t));
+    pairings = (pairing_t *)malloc (EVOLVE_POPULATION * num_bench
+                                    * sizeof (pairing_t));
+    scores = (uint32_t (*)[2])malloc ((uint64_t )EVOLVE_POPULATION
+                                      * num_bench * num_rounds
+                                      * sizeof (uint32_t[2]));
+    if (entrants == NULL || names == NULL || insns == NULL
+        || pairings == NULL || scores == NULL)
+    {
+      fprintf (stderr, "ERROR: Unable to allocate memory for the "
+               "population.\n\n");
+      error = 1;
+    }
+  }
+
+  /* Every warrior in the population has room of its own for as many
+     instructions as a programme can have. The first generation is the
+     first warrior and copies of it with a mutation each. */
+  if (error == 0)
+  {
+    memcpy (entrants, &warriors[1], num_bench * sizeof (warrior_t));
+    pop = &entrants[num_bench];
+
+    for (unsigned int i = 0U; i < EVOLVE_POPULATION; i++)
+    {
+      pop[i] = warriors[0];
+      pop[i].insns = &insns[i * max_prog_insns];
+      pop[i].name = names[i];
+      pop[i].version = NULL;
+      memcpy (pop[i].insns, warriors[0].insns,
+              warriors[0].num_insns * sizeof (cell_t));
+      snprintf (names[i], MAX_EVOLVED_NAME_LEN + 1U, "%.96s 0.%u",
+                warriors[0].name, i);
+      born[i] = 0U;
+      if (i > 0U)
+      {
+        mutate (&pop[i], &rng);
+      }
+    }
+
+    printf ("Ancestor:\n    \"%s\"\n\n", warriors[0].name);
+    printf ("Benchmark:\n");
+    for (unsigned int b = 0U; b < num_bench; b++)
+    {
+      printf ("%4u. \"%s\"\n", b + 1U, entrants[b].name);
+    }
+    printf ("\nGenerations:\n  Generation      Best        Mean\n");
+
+    error = score_candidates (entrants, num_bench, num_bench,
+                              EVOLVE_POPULATION, num_rounds, num_threads,
+                              seed, stride, spread, pairings, scores,
+                              totals);
+  }
+
+  for (unsigned int g = 0U; error == 0 && g <= num_generations; g++)
+  {
+    uint64_t sum = 0U;
+
+    /* The offspring take the places of the warriors that did not survive,
+       keeping their room for instructions and their names. */
+    for (unsigned int i = EVOLVE_SURVIVORS; g > 0U && i < EVOLVE_POPULATION;
+         i++)
+    {
+      const warrior_t *parent = &pop[rng_next (&rng) % EVOLVE_SURVIVORS];
+      cell_t *room = pop[i].insns;
+      char *name = pop[i].name;
+      unsigned int num_mutations = 1U + rng_next (&rng) % EVOLVE_MUTATIONS;
+
+      memcpy (room, parent->insns, parent->num_insns * sizeof (cell_t));
+      pop[i] = *parent;
+      pop[i].insns = room;
+      pop[i].name = name;
+      snprintf (name, MAX_EVOLVED_NAME_LEN + 1U, "%.96s %u.%u",
+                warriors[0].name, g, i);
+      born[i] = g;
+      for (unsigned int m = 0U; m < num_mutations; m++)
+      {
+        mutate (&pop[i], &rng);
+      }
+    }
+
+    if (g > 0U)
+    {
+      error = score_candidates (entrants, num_bench,
+                                num_bench + EVOLVE_SURVIVORS,
+                                EVOLVE_POPULATION - EVOLVE_SURVIVORS,
+                                num_rounds, num_threads, seed, stride,
+                                spread, pairings, scores,
+                                totals + EVOLVE_SURVIVORS);
+    }
+
+    if (error == 0)
+    {
+      sort_population (pop, totals, born, EVOLVE_POPULATION);
+      for (unsigned int i = 0U; i < EVOLVE_POPULATION; i++)
+      {
+        sum += totals[i];
+      }
+      printf ("  %10u %9" PRIu32 " %11.1f\n", g, totals[0],
+              (double )sum / EVOLVE_POPULATION);
+    }
+  }
+
+  if (error == 0)
+  {
+    printf ("\nSurvivors:\n");
+    for (unsigned int i = 0U; i < EVOLVE_SURVIVORS; i++)
+    {
+      printf ("%4u. \"%s\" (born in generation %u) %9" PRIu32 "\n", i + 1U,
+              pop[i].name, born[i], totals[i]);
+    }
+    printf ("\n");
+
+    error = write_survivors (pop, out_dir);
+  }
+
+  free (entrants);
+  free (names);
+  free (insns);
+  free (pairings);
+  free (scores);
+
+  return error;
+}
@@ -0,0 +1,19 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the evolution of warriors.
+*/
+
+#ifndef EVOLVE_H_INCLUDED
+#define EVOLVE_H_INCLUDED
+
+extern int
+evolve_run (const warrior_t *warriors, unsigned int num_warriors,
+            unsigned int num_generations, unsigned int num_rounds,
+            unsigned int num_threads, uint64_t seed, unsigned int stride,
+            bool spread, const char *out_dir);
+
+#endif /* EVOLVE_H_INCLUDED */
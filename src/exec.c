@@ -14,31 +14,220 @@
 #include <string.h>
 
 #include "zinc.h"
+#include "mars.h"
 #include "exec.h"
 #include "sdlui.h"
+#include "modarith.h"
+#include "core.h"
+
+/* The number of addressing modes. */
+#define NUM_MODES (MODE_INDIRECT + 1U)
+
+/* The handler for an instruction with the opcode OP and the addressing
+   modes MA and MB for its operands. There is a separate handler for every
+   combination of an opcode and addressing modes. */
+#define HANDLER_FOR(op, ma, mb) \
+  (((op) * NUM_MODES + (ma)) * NUM_MODES + (mb))
+
+/* The handler for an instruction with an invalid opcode or addressing
+   mode. */
+#define HANDLER_INVALID \
+  (HANDLER_FOR (OP_SPL, MODE_INDIRECT, MODE_INDIRECT) + 1U)
+
+/* The number of handlers in a set of handlers. There is a set of handlers
+   for each kind of task queues (see select_engine):
+
+     GENERAL - the task queues are rotated after every instruction;
+     SINGLE  - every warrior runs a single task, which stays put.
+
+   The handler H of a predecoded instruction is handler H in the set in
+   use, which starts at QUEUE_BASE_Q for the kind Q of the task queues. */
+#define NUM_HANDLERS (HANDLER_INVALID + 1U)
+#define QUEUE_BASE_GENERAL 0U
+#define QUEUE_BASE_SINGLE NUM_HANDLERS
+
+/* Invokes the macro M with the kind Q of the task queues, the opcode OP
+   and each combination of the addressing modes for the operands, in the
+   order of their handlers. */
+#define FOR_EACH_MODE_PAIR(m, q, op) \
+  m (q, op, MODE_IMMEDIATE, MODE_IMMEDIATE) \
+  m (q, op, MODE_IMMEDIATE, MODE_DIRECT) \
+  m (q, op, MODE_IMMEDIATE, MODE_INDIRECT) \
+  m (q, op, MODE_DIRECT, MODE_IMMEDIATE) \
+  m (q, op, MODE_DIRECT, MODE_DIRECT) \
+  m (q, op, MODE_DIRECT, MODE_INDIRECT) \
+  m (q, op, MODE_INDIRECT, MODE_IMMEDIATE) \
+  m (q, op, MODE_INDIRECT, MODE_DIRECT) \
+  m (q, op, MODE_INDIRECT, MODE_INDIRECT)
+
+/* Invokes the macro M with the kind Q of the task queues and each opcode,
+   in the order of their handlers. */
+#define FOR_EACH_OPCODE(m, q) \
+  m (q, OP_DAT) \
+  m (q, OP_MOV) \
+  m (q, OP_ADD) \
+  m (q, OP_SUB) \
+  m (q, OP_MUL) \
+  m (q, OP_DIV) \
+  m (q, OP_MOD) \
+  m (q, OP_JMP) \
+  m (q, OP_JMZ) \
+  m (q, OP_JMN) \
+  m (q, OP_SKL) \
+  m (q, OP_SKE) \
+  m (q, OP_SKN) \
+  m (q, OP_SKG) \
+  m (q, OP_SPL)
+
+/* The simulator can be built with one of two engines for dispatching
+   instructions to their handlers - a giant switch statement, which is the
+   default, or threaded code that jumps from the end of a handler straight
+   to the handler for the next instruction (define ZINC_THREADED_DISPATCH
+   for this). The latter needs the "labels as values" extension of GCC.
+   The handlers are written only once with the help of these macros:
+
+     DISPATCH (H)            - dispatches to the handler H in the set of
+                               handlers in use among those that follow
+                               in a block;
+     USE_HANDLERS (Q)        - puts the set of handlers for the kind Q of
+                               task queues in use;
+     HANDLER (Q, OP, MA, MB) - labels the handler for OP, MA and MB in the
+                               set for Q;
+     HANDLER_DEFAULT         - labels the handler for an invalid
+                               instruction, which is shared by the sets;
+     NEXT_TASK ()            - ends a handler that has not changed the
+                               state of the battle;
+     END_TASK ()             - ends any other handler.
+
+   A handler itself moves the current task of the current warrior to the
+   end of its task queue (or kills it). In the threaded engine, NEXT_TASK()
+   then rotates to the next warrior and jumps straight to the handler for
+   its instruction, as long as there is nothing else to do in this cycle.
+   Otherwise it jumps to the "next_task" handler, which does the general
+   rotation to the next warrior, updates the user interface, etc. */
+#ifdef ZINC_THREADED_DISPATCH
+
+#ifndef __GNUC__
+#error "The threaded engine needs GCC."
+#endif
+
+#define DISPATCH(h) goto *handlers[(h)];
+#define USE_HANDLERS(q) handlers = &all_handlers[QUEUE_BASE_##q]
+#define HANDLER(q, op, ma, mb) handle_##q##_##op##_##ma##_##mb
+#define HANDLER_DEFAULT handle_HANDLER_INVALID
+#define END_TASK() goto next_task
+
+#define NEXT_TASK() \
+  do \
+  { \
+    if (execed_insns + 1U < fast_cycles) \
+    { \
+      execed_insns += 1U; \
+      curr_warrior \
+        = (curr_warrior + 1U < m->num_warriors) ? curr_warrior + 1U : 0U; \
+      pc = CURR_TASK_PC (&m->warriors[curr_warrior]); \
+      insn = &m->decoded[pc]; \
+      goto *handlers[insn->handler]; \
+    } \
+    goto next_task; \
+  } while (0)
+
+/* The address of the handler for OP, MA and MB in the set for Q in the
+   table of handlers. */
+#define HANDLER_ADDR(q, op, ma, mb) &&HANDLER (q, op, ma, mb),
+
+/* The addresses of the handlers for OP in the set for Q in the table of
+   handlers. */
+#define HANDLER_ADDRS(q, op) FOR_EACH_MODE_PAIR (HANDLER_ADDR, q, op)
+
+/* The addresses of the handlers in the set for Q in the table of
+   handlers. */
+#define HANDLER_SET_ADDRS(q) \
+  FOR_EACH_OPCODE (HANDLER_ADDRS, q) \
+  &&HANDLER_DEFAULT,
+
+#else /* !ZINC_THREADED_DISPATCH */
+
+#define DISPATCH(h) switch ((h) + queue_base)
+#define USE_HANDLERS(q) queue_base = QUEUE_BASE_##q
+#define HANDLER(q, op, ma, mb) case HANDLER_FOR (op, ma, mb) + QUEUE_BASE_##q
+#define HANDLER_DEFAULT default
+#define END_TASK() break
+#define NEXT_TASK() break
+
+#endif /* ZINC_THREADED_DISPATCH */
+
+/* A predecoded instruction. The simulator keeps one of these for every cell
+   in the core, so that an instruction need not be decoded and its operands
+   need not be normalised afresh every time it is executed. A cell is decoded
+   again whenever an instruction writes into it. */
+typedef struct decoded_insn
+{
+  /* The handler for the instruction (see HANDLER_FOR). */
+  uint8_t handler;
+
+  /* The resolved first operand. This is the value of the operand in
+     immediate addressing mode, or the normalised address of the cell it
+     refers to otherwise. */
+  cell_addr_t a;
+
+  /* The resolved second operand, as for A. */
+  cell_addr_t b;
+} decoded_insn_t;
+
+
+
+/* Moves the current task of the warrior W in the simulator M to the end of
+   its task queue with its programme counter set to PC. The next task in the
+   queue becomes the current task. */
+static void
+requeue_task (mars_t *m, warrior_t *w, cell_addr_t pc)
+{
+  unsigned int tail = w->curr_task + w->num_tasks;
+  if (tail >= m->max_prog_tasks)
+  {
+    tail -= m->max_prog_tasks;
+  }
 
-/* Clamp the value of X to within 0 to CORE_SIZE - 1. The leaving
-   out of the normal parentheses protecting X in macros is intentional,
-   as is the leaving out of the terminating semi-colon. */
-#define CLAMP_VAL(x) \
-  while (x >= core_size) x -= core_size
+  w->task_pcs[tail] = pc;
 
-static unsigned int execed_insns;
+  w->curr_task += 1U;
+  if (w->curr_task >= m->max_prog_tasks)
+  {
+    w->curr_task = 0U;
+  }
+}
+
+
+/* Adds a new task with the programme counter PC at the end of the task
+   queue of the warrior W in the simulator M. The caller must ensure that
+   there is room for it in the queue. */
+static void
+add_task (mars_t *m, warrior_t *w, cell_addr_t pc)
+{
+  unsigned int tail = w->curr_task + w->num_tasks;
+  if (tail >= m->max_prog_tasks)
+  {
+    tail -= m->max_prog_tasks;
+  }
 
-static cell_t tmp_cell;
+  w->task_pcs[tail] = pc;
+  w->num_tasks += 1U;
+}
 
 
-/* Kills the current task of the warrior at index IDX. If this was the last
-   task in the warrior's tasks queue, declare the warrior dead by returning
-   TRUE, else return FALSE. */
+/* Kills the current task of the warrior at index IDX in the simulator M.
+   If this was the last task in the warrior's tasks queue, declare the
+   warrior dead by returning TRUE, else return FALSE. */
 static bool
-kill_curr_task (unsigned int idx)
+kill_curr_task (mars_t *m, unsigned int idx)
 {
   bool kill_warrior = false;
+  warrior_t *w = &m->warriors[idx];
 
-  if (warriors[idx].num_tasks > 0U)
+  if (w->num_tasks > 0U)
   {
-    warriors[idx].num_tasks -= 1U;
+    w->num_tasks -= 1U;
   }
   else
   {
@@ -49,55 +238,48 @@ kill_curr_task (unsigned int idx)
     return true;
   }
 
-  if (warriors[idx].tasks->next == warriors[idx].tasks)
+  if (w->num_tasks == 0U)
   {
     /* This was the last remaining task in the warrior's task queue. This
-       warrior programme is dead. */
+       warrior programme is dead.
 
-    // Note: We do not invalidate the task pointer as it is needed for
-    // showing to the user the last instruction that faulted.
-    //
-    // warriors[idx].tasks->pc = INVALID_CELL_ADDR;
-    // free (warriors[idx].tasks);
-    // warriors[idx].tasks = NULL;
-
-    warriors[idx].tasks->next = NULL;
-    warriors[idx].alive = false;
+       Note: We leave the dead task as the current task as it is needed for
+       showing to the user the last instruction that faulted. */
+    w->alive = false;
     kill_warrior = true;
   }
   else
   {
-    /* Kill this task.
-       Since the task queue is a singly-linked circular list, we "remove"
-       the current node by copying over the data of the next node and
-       then removing that node. This is a favourite question for many an
-       interviewer. */
-
-    task_t *tmp_task_ptr = warriors[idx].tasks->next;
-    warriors[idx].tasks->pc = tmp_task_ptr->pc;
-    warriors[idx].tasks->next = tmp_task_ptr->next;
+    /* Kill this task by making the next task in the queue the current task.
+       Note that the new current task is then moved to the end of the queue
+       without getting to execute an instruction in this cycle. Battle
+       outcomes depend on this order of execution of tasks, so it is
+       retained. */
+    w->curr_task += 1U;
+    if (w->curr_task >= m->max_prog_tasks)
+    {
+      w->curr_task = 0U;
+    }
 
-    tmp_task_ptr->pc = INVALID_CELL_ADDR;
-    tmp_task_ptr->next = NULL;
-    free (tmp_task_ptr);
+    requeue_task (m, w, CURR_TASK_PC (w));
   }
 
   return kill_warrior;
 }
 
 
-/* Updates the scores at the end of a battle. If a warrior is alive at
-   end of a battle, it is awarded (W^2 - 1)/S points, where W is the
-   total number of warriors and S is the number of warriors that survived
-   the battle. */
+/* Updates the scores in the simulator M at the end of a battle. If a
+   warrior is alive at end of a battle, it is awarded (W^2 - 1)/S points,
+   where W is the total number of warriors and S is the number of warriors
+   that survived the battle. */
 static void
-update_scores (void)
+update_scores (mars_t *m)
 {
   unsigned int num_survivors = 0;
 
-  for (unsigned int i = 0; i < num_warriors; i++)
+  for (unsigned int i = 0; i < m->num_warriors; i++)
   {
-    if (warriors[i].alive == true)
+    if (m->warriors[i].alive == true)
     {
       num_survivors++;
     }
@@ -105,406 +287,492 @@ update_scores (void)
 
   uint32_t points
     = (num_survivors == 0U) ? 0U
-      : (num_warriors * num_warriors - 1U) / num_survivors;
+      : (m->num_warriors * m->num_warriors - 1U) / num_survivors;
 
-  for (unsigned int i = 0; i < num_warriors; i++)
+  for (unsigned int i = 0; i < m->num_warriors; i++)
   {
-    if (warriors[i].alive == true)
+    if (m->warriors[i].alive == true)
     {
-      warriors[i].score += points;
+      m->warriors[i].score += points;
     }
   }
 }
 
 
-/* Gets the operand for the operand field value OP and addressing mode
-   MODE for an instruction located at PC. Returns a pointer to the intended
-   cell and the address of the intended cell in ADDR. */
-static cell_t *
-get_operand (uint8_t mode, cell_addr_t op, cell_addr_t pc, cell_addr_t *addr)
+/* Resolves the operand field value OP with addressing mode MODE for an
+   instruction located at PC into the form kept by a predecoded
+   instruction. */
+static cell_addr_t
+resolve_operand (uint8_t mode, cell_addr_t op, cell_addr_t pc)
 {
-  cell_t *ret_val = NULL;
+  cell_addr_t ret_val = op;
 
-  switch (mode)
+  if (mode != MODE_IMMEDIATE)
   {
-  case MODE_IMMEDIATE:
-    memset (&tmp_cell, 0, sizeof (cell_t));
-    tmp_cell.op_b = op;
-    *addr = op;
-    ret_val = &tmp_cell;
-    break;
-
-  case MODE_DIRECT:
-    *addr = (pc + op);
-    CLAMP_VAL (*addr);
-    ret_val = &core[*addr];
-    break;
-
-  case MODE_INDIRECT:
-    pc = (pc + op);
-    CLAMP_VAL (pc);
-    *addr = pc + core[pc].op_b;
-    CLAMP_VAL (*addr);
-    ret_val = &core[*addr];
-    break;
-
-  default:
-    fprintf (stderr, "Internal Error (invalid mode %u) in fetch_operand.\n",
-             mode);
-    break;
+    ret_val = mod_add (pc, op);
   }
 
   return ret_val;
 }
 
 
-/* Executes a battle. Returns the error code, the status of the battle in
-   STATUS, the user's wish in CMD and the warrior on whose task the simulation
-   ended in END_WARRIOR. */
-int
-exec_battle (battle_status_t *status, user_wish_t *cmd,
-             unsigned int *end_warrior)
+/* Decodes the instruction in the cell at ADDR in the simulator M into its
+   entry in the predecoded shadow of the core. */
+static void
+decode_cell (mars_t *m, cell_addr_t addr)
 {
-  int error = 0;
+  uint8_t op_code = CELL_OP_CODE (m, addr);
+  uint8_t mode_a = CELL_MODE_A (m, addr);
+  uint8_t mode_b = CELL_MODE_B (m, addr);
+  decoded_insn_t *insn = &m->decoded[addr];
 
-  cell_addr_t mod_cell;
-
-  unsigned int alive_warriors = num_warriors;
-  unsigned int curr_warrior = 0U;
-  *end_warrior = curr_warrior;
-  execed_insns = 0U;
-  while (execed_insns < max_cycles && *cmd == CONTINUE_BATTLE)
+  if (op_code > OP_SPL || mode_a > MODE_INDIRECT || mode_b > MODE_INDIRECT)
   {
-    mod_cell = INVALID_CELL_ADDR;
+    insn->handler = HANDLER_INVALID;
+  }
+  else
+  {
+    insn->handler = HANDLER_FOR (op_code, mode_a, mode_b);
+  }
+
+  insn->a = resolve_operand (mode_a, CELL_OP_A (m, addr), addr);
+  insn->b = resolve_operand (mode_b, CELL_OP_B (m, addr), addr);
+}
 
-    if (warriors[curr_warrior].tasks != NULL)
-    {
-      cell_t *cell;
-      cell_t *op1, *op2;
-      cell_addr_t addr_A, addr_B;
-      cell_addr_t val_A, val_B;
-      bool kill_warrior;
-
-      // Decode the instruction at the cell pointed to by the PC of the
-      // current task of the current warrior.
-      //
-      // We use a giant switch statement to figure out what to do for a given
-      // opcode. An alternative would have been to use a table of pointers to
-      // decoder functions.
 
-      cell = &core[warriors[curr_warrior].tasks->pc];
-      switch (cell->op_code)
+/* Selects the variant of the engine suited to the warriors in the current
+   battle in the simulator M by looking at their instructions. Since the
+   core starts out filled with "DAT #0" and instructions are only ever
+   copied between cells, no instruction that is not in a warrior can turn up
+   during the battle.
+
+   Without a SPL in any warrior, or with a single task allowed per warrior,
+   every warrior runs a single task and the battle is run by the set of
+   handlers for single tasks, which just update the programme counter of
+   the task in place instead of rotating its task queue. (Warriors without
+   DIV or MOD need no variant of their own, as the check for division by
+   zero is only made by the handlers for those opcodes.) */
+static void
+select_engine (mars_t *m)
+{
+  m->single_task = true;
+  if (m->max_prog_tasks > 1U)
+  {
+    for (unsigned int i = 0U; i < m->num_warriors; i++)
+    {
+      for (unsigned int j = 0U; j < m->warriors[i].num_insns; j++)
       {
-      case OP_DAT:
-        kill_warrior = kill_curr_task (curr_warrior);
-        if (kill_warrior == true)
-        {
-          alive_warriors -= 1U;
-
-          /* If there was only a single loaded warrior and it is killed or
-             if there were multiple loaded warriors and now only one is
-             alive, we need to end the simulation. */
-          if (alive_warriors == 0U || alive_warriors == 1U)
-          {
-            *cmd = RELOAD_WARRIORS;
-          }
-
-          /* FIXME: Assumes only two warriors. */
-          *status
-            = (curr_warrior == 0U) ? WARRIOR_1_KILLED : WARRIOR_2_KILLED;
-        }
-        break;
-      
-      case OP_MOV:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        memcpy (op2, op1, sizeof (cell_t));
-        op2->marker = warriors[curr_warrior].id;
-        mod_cell = addr_B;
-        warriors[curr_warrior].tasks->pc++;
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        break;
-
-      case OP_ADD:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        op2->op_b = op1->op_b + op2->op_b;
-        CLAMP_VAL (op2->op_b);
-        op2->marker = warriors[curr_warrior].id;
-        mod_cell = addr_B;
-        warriors[curr_warrior].tasks->pc++;
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        break;
-
-      case OP_SUB:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        op2->op_b = op2->op_b + core_size - op1->op_b;
-        CLAMP_VAL (op2->op_b);
-        op2->marker = warriors[curr_warrior].id;
-        mod_cell = addr_B;
-        warriors[curr_warrior].tasks->pc++;
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        break;
-
-      case OP_MUL:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        op2->op_b
-          = (cell_addr_t )((uint32_t )op1->op_b * (uint32_t )op2->op_b);
-        CLAMP_VAL (op2->op_b);
-        op2->marker = warriors[curr_warrior].id;
-        mod_cell = addr_B;
-        warriors[curr_warrior].tasks->pc++;
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        break;
-
-      case OP_DIV:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        if (op1->op_b == 0U)
-        {
-          alive_warriors -= 1U;
-
-          /* If there was only a single loaded warrior and it is killed or
-             if there were multiple loaded warriors and now only one is
-             alive, we need to end the simulation. */
-          if (alive_warriors == 0U || alive_warriors == 1U)
-          {
-            *cmd = RELOAD_WARRIORS;
-          }
-
-          /* FIXME: Assumes only two warriors. */
-          *status
-            = (curr_warrior == 0U) ? WARRIOR_1_KILLED : WARRIOR_2_KILLED;
-        }
-        else
-        {
-          op2->op_b
-            = (cell_addr_t )((uint32_t )op2->op_b / (uint32_t )op1->op_b);
-          CLAMP_VAL (op2->op_b);
-          op2->marker = warriors[curr_warrior].id;
-          mod_cell = addr_B;
-          warriors[curr_warrior].tasks->pc++;
-          CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        }
-        break;
-
-      case OP_MOD:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        if (op1->op_b == 0U)
-        {
-          alive_warriors -= 1U;
-
-          /* If there was only a single loaded warrior and it is killed or
-             if there were multiple loaded warriors and now only one is
-             alive, we need to end the simulation. */
-          if (alive_warriors == 0U || alive_warriors == 1U)
-          {
-            *cmd = RELOAD_WARRIORS;
-          }
-
-          /* FIXME: Assumes only two warriors. */
-          *status
-            = (curr_warrior == 0U) ? WARRIOR_1_KILLED : WARRIOR_2_KILLED;
-        }
-        else
-        {
-          op2->op_b
-            = (cell_addr_t )((uint32_t )op2->op_b % (uint32_t )op1->op_b);
-          CLAMP_VAL (op2->op_b);
-          op2->marker = warriors[curr_warrior].id;
-          mod_cell = addr_B;
-          warriors[curr_warrior].tasks->pc++;
-          CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        }
-        break;
-
-      case OP_JMP:
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        warriors[curr_warrior].tasks->pc = addr_B;
-        break;
-
-      case OP_JMZ:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        if (op1->op_b == 0U)
-        {
-          warriors[curr_warrior].tasks->pc = addr_B;
-        }
-        else
+        if (m->warriors[i].insns[j].op_code == OP_SPL)
         {
-          warriors[curr_warrior].tasks->pc++;
-          CLAMP_VAL (warriors[curr_warrior].tasks->pc);
+          m->single_task = false;
         }
-        break;
-
-      case OP_JMN:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        if (op1->op_b != 0U)
-        {
-          warriors[curr_warrior].tasks->pc = addr_B;
-        }
-        else
-        {
-          warriors[curr_warrior].tasks->pc++;
-          CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        }
-        break;
+      }
+    }
+  }
+}
 
-      case OP_SKL:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        val_A = op1->op_b;
 
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        val_B = op2->op_b;
+/* Allocates the predecoded shadow of the core of the simulator M. Must be
+   called after the core has been allocated. Returns 0 on success, 1 on
+   failure. */
+int
+exec_init (mars_t *m)
+{
+  int error = 0;
 
-        if (val_A < val_B)
-        {
-          warriors[curr_warrior].tasks->pc += 2;
-        }
-        else
-        {
-          warriors[curr_warrior].tasks->pc += 1;
-        }
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        break;
+  m->decoded
+    = (decoded_insn_t *)malloc (core_size * sizeof (decoded_insn_t));
+  if (m->decoded == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for decoded core.\n");
+    error = 1;
+  }
+
+  return error;
+}
 
-      case OP_SKE:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        val_A = op1->op_b;
 
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        val_B = op2->op_b;
+/* Frees the predecoded shadow of the core of the simulator M. */
+void
+exec_free (mars_t *m)
+{
+  free (m->decoded);
+  m->decoded = NULL;
+}
 
-        if (val_A == val_B)
-        {
-          warriors[curr_warrior].tasks->pc += 2;
-        }
-        else
-        {
-          warriors[curr_warrior].tasks->pc += 1;
-        }
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        break;
 
-      case OP_SKN:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        val_A = op1->op_b;
+/* The following macros implement the handlers for the instructions within
+   exec_battle. The addressing modes MA and MB of the operands are constants
+   in every handler, so the tests on them are all resolved at compile-time
+   and every handler only does the work needed for its own combination of
+   addressing modes. An operand in immediate addressing mode is read straight
+   from the instruction. */
+
+/* The value used from the cell at the normalised address ADDR referred to by
+   the resolved operand OP in indirect addressing mode. With a mirrored core,
+   the value is read without waiting for ADDR to be normalised, which the
+   compiler can then leave out altogether if ADDR is not used. */
+#ifdef ZINC_MIRRORED_CORE
+#define INDIRECT_VAL(op, addr) CELL_OP_B (m, (op) + CELL_OP_B (m, op))
+#else
+#define INDIRECT_VAL(op, addr) CELL_OP_B (m, addr)
+#endif
+
+/* Sets ADDR to the address of the cell referred to by the resolved operand
+   OP (see decode_cell) in addressing mode MODE and VAL to the value used from
+   it. The address of an immediate operand is the operand itself. */
+#define FETCH_OPERAND(mode, op, addr, val) \
+  do \
+  { \
+    if ((mode) == MODE_IMMEDIATE) \
+    { \
+      addr = (op); \
+      val = (op); \
+    } \
+    else if ((mode) == MODE_DIRECT) \
+    { \
+      addr = (op); \
+      val = CELL_OP_B (m, addr); \
+    } \
+    else \
+    { \
+      addr = mod_add ((op), CELL_OP_B (m, op)); \
+      val = INDIRECT_VAL ((op), addr); \
+    } \
+  } while (0)
+
+/* Fetches both the operands of the current instruction. */
+#define FETCH_OPERANDS(ma, mb) \
+  FETCH_OPERAND (ma, insn->a, addr_A, val_A); \
+  FETCH_OPERAND (mb, insn->b, addr_B, val_B)
+
+/* The value of operand A as seen by an instruction after fetching operand B.
+   There is only a single imaginary cell for immediate operands, so if both
+   the operands are immediate, this is the value of operand B. */
+#define LATE_VAL_A(ma, mb) \
+  (((ma) == MODE_IMMEDIATE && (mb) == MODE_IMMEDIATE) ? val_B : val_A)
+
+/* Stores VAL into the B-field of the cell referred to by operand B in
+   addressing mode MB for the current warrior. Storing into an immediate
+   operand has no effect. */
+#define STORE_OP_B(mb, val) \
+  do \
+  { \
+    if ((mb) != MODE_IMMEDIATE) \
+    { \
+      CELL_OP_B (m, addr_B) = (val); \
+      MARK_CELL (m, addr_B, m->warriors[curr_warrior].id); \
+      MIRROR_CELL (m, addr_B); \
+      mod_cell = addr_B; \
+      decode_cell (m, addr_B); \
+    } \
+  } while (0)
+
+/* Moves the current task to the end of the task queue of the current
+   warrior, of the kind Q, with its PC advanced by N cells. */
+#define ADVANCE_PC(q, n) JUMP_TO (q, mod_add (pc, (n)))
+
+/* Moves the current task to the end of the task queue of the current
+   warrior, of the kind Q, with its PC set to ADDR. A single task is the
+   whole of its queue, so only its PC changes. */
+#define JUMP_TO(q, addr) REQUEUE_##q (&m->warriors[curr_warrior], (addr))
+#define REQUEUE_GENERAL(w, addr) requeue_task (m, (w), (addr))
+#define REQUEUE_SINGLE(w, addr) (w)->task_pcs[(w)->curr_task] = (addr)
+
+/* Takes note of a task having been added to the task queue of the current
+   warrior, of the kind Q. Instructions are only ever copied from one cell
+   to another, so this cannot happen with single tasks (see select_engine),
+   but should it happen anyway, the battle goes on with the general task
+   queues, which a single task is a consistent state of. */
+#define TASK_ADDED(q) TASK_ADDED_##q ()
+#define TASK_ADDED_GENERAL() do { } while (0)
+#define TASK_ADDED_SINGLE() \
+  do \
+  { \
+    m->single_task = false; \
+    USE_HANDLERS (GENERAL); \
+  } while (0)
+
+/* Takes note of the death of the current warrior. */
+#define WARRIOR_KILLED() \
+  do \
+  { \
+    alive_warriors -= 1U; \
+    /* If there was only a single loaded warrior and it is killed or \
+       if there were multiple loaded warriors and now only one is \
+       alive, we need to end the simulation. */ \
+    if (alive_warriors == 0U || alive_warriors == 1U) \
+    { \
+      *cmd = RELOAD_WARRIORS; \
+    } \
+    /* FIXME: Assumes only two warriors. */ \
+    *status = (curr_warrior == 0U) ? WARRIOR_1_KILLED : WARRIOR_2_KILLED; \
+  } while (0)
+
+#define EXEC_OP_DAT(q, ma, mb) \
+  { \
+    if (kill_curr_task (m, curr_warrior) == true) \
+    { \
+      WARRIOR_KILLED (); \
+    } \
+    END_TASK (); \
+  }
 
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        val_B = op2->op_b;
+#define EXEC_OP_MOV(q, ma, mb) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    if ((mb) != MODE_IMMEDIATE) \
+    { \
+      if ((ma) == MODE_IMMEDIATE) \
+      { \
+        SET_CELL_INSN (m, addr_B, OP_DAT, MODE_IMMEDIATE, MODE_IMMEDIATE); \
+        CELL_OP_A (m, addr_B) = 0U; \
+        CELL_OP_B (m, addr_B) = val_A; \
+      } \
+      else \
+      { \
+        COPY_CELL (m, addr_B, addr_A); \
+      } \
+      MARK_CELL (m, addr_B, m->warriors[curr_warrior].id); \
+      MIRROR_CELL (m, addr_B); \
+      mod_cell = addr_B; \
+      decode_cell (m, addr_B); \
+    } \
+    ADVANCE_PC (q, 1U); \
+    NEXT_TASK (); \
+  }
 
-        if (val_A != val_B)
-        {
-          warriors[curr_warrior].tasks->pc += 2;
-        }
-        else
-        {
-          warriors[curr_warrior].tasks->pc += 1;
-        }
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        break;
+#define EXEC_OP_ADD(q, ma, mb) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    val_B = mod_add (val_B, LATE_VAL_A (ma, mb)); \
+    STORE_OP_B (mb, val_B); \
+    ADVANCE_PC (q, 1U); \
+    NEXT_TASK (); \
+  }
 
-      case OP_SKG:
-        op1 = get_operand (cell->mode_a, cell->op_a,
-                           warriors[curr_warrior].tasks->pc, &addr_A);
-        val_A = op1->op_b;
+#define EXEC_OP_SUB(q, ma, mb) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    val_B = mod_sub (val_B, LATE_VAL_A (ma, mb)); \
+    STORE_OP_B (mb, val_B); \
+    ADVANCE_PC (q, 1U); \
+    NEXT_TASK (); \
+  }
 
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        val_B = op2->op_b;
+#define EXEC_OP_MUL(q, ma, mb) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    val_B = mod_reduce ((cell_addr_t )((uint32_t )LATE_VAL_A (ma, mb) \
+                                       * (uint32_t )val_B)); \
+    STORE_OP_B (mb, val_B); \
+    ADVANCE_PC (q, 1U); \
+    NEXT_TASK (); \
+  }
 
-        if (val_A > val_B)
-        {
-          warriors[curr_warrior].tasks->pc += 2;
-        }
-        else
-        {
-          warriors[curr_warrior].tasks->pc += 1;
-        }
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-        break;
-
-      case OP_SPL:
-        op2 = get_operand (cell->mode_b, cell->op_b,
-                           warriors[curr_warrior].tasks->pc, &addr_B);
-        warriors[curr_warrior].tasks->pc++;
-        CLAMP_VAL (warriors[curr_warrior].tasks->pc);
-
-        /* SPL creates a new task only if the warrior can afford to have
-           more tasks. Note that the new task is added at the end of the
-           task queue *after* the task that spawned it. This is a little
-           detail that is crucial to the correct operation of many a 
-           warrior out there. */
-        if (warriors[curr_warrior].num_tasks < max_prog_tasks)
-        {
-          /* We add the node for the new task after the current node and
-             adjust the warriors current task pointer to point to it. This
-             ensures that the next instruction will be picked up from the
-             task that originally came in the task queue after the task
-             that spawned this new task. */
-          task_t *task = (task_t *)malloc (sizeof (task_t));
-          task->pc = addr_B;
-          task->next = warriors[curr_warrior].tasks->next;
-          warriors[curr_warrior].tasks->next = task;
-          warriors[curr_warrior].tasks = task;
-          warriors[curr_warrior].num_tasks += 1U;
-        }
-        break;
+#define EXEC_OP_DIV(q, ma, mb) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    if (LATE_VAL_A (ma, mb) == 0U) \
+    { \
+      WARRIOR_KILLED (); \
+      END_TASK (); \
+    } \
+    val_B \
+      = (cell_addr_t )((uint32_t )val_B / (uint32_t )LATE_VAL_A (ma, mb)); \
+    STORE_OP_B (mb, val_B); \
+    ADVANCE_PC (q, 1U); \
+    NEXT_TASK (); \
+  }
+
+#define EXEC_OP_MOD(q, ma, mb) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    if (LATE_VAL_A (ma, mb) == 0U) \
+    { \
+      WARRIOR_KILLED (); \
+      END_TASK (); \
+    } \
+    val_B \
+      = (cell_addr_t )((uint32_t )val_B % (uint32_t )LATE_VAL_A (ma, mb)); \
+    STORE_OP_B (mb, val_B); \
+    ADVANCE_PC (q, 1U); \
+    NEXT_TASK (); \
+  }
+
+#define EXEC_OP_JMP(q, ma, mb) \
+  { \
+    FETCH_OPERAND (mb, insn->b, addr_B, val_B); \
+    JUMP_TO (q, addr_B); \
+    NEXT_TASK (); \
+  }
+
+#define EXEC_OP_JMZ(q, ma, mb) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    if (LATE_VAL_A (ma, mb) == 0U) \
+    { \
+      JUMP_TO (q, addr_B); \
+    } \
+    else \
+    { \
+      ADVANCE_PC (q, 1U); \
+    } \
+    NEXT_TASK (); \
+  }
+
+#define EXEC_OP_JMN(q, ma, mb) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    if (LATE_VAL_A (ma, mb) != 0U) \
+    { \
+      JUMP_TO (q, addr_B); \
+    } \
+    else \
+    { \
+      ADVANCE_PC (q, 1U); \
+    } \
+    NEXT_TASK (); \
+  }
+
+/* Skips the next instruction if VAL_A and VAL_B satisfy the relation REL. */
+#define EXEC_SKIP(q, ma, mb, rel) \
+  { \
+    FETCH_OPERANDS (ma, mb); \
+    ADVANCE_PC (q, (val_A rel val_B) ? 2U : 1U); \
+    NEXT_TASK (); \
+  }
+
+#define EXEC_OP_SKL(q, ma, mb) EXEC_SKIP (q, ma, mb, <)
+#define EXEC_OP_SKE(q, ma, mb) EXEC_SKIP (q, ma, mb, ==)
+#define EXEC_OP_SKN(q, ma, mb) EXEC_SKIP (q, ma, mb, !=)
+#define EXEC_OP_SKG(q, ma, mb) EXEC_SKIP (q, ma, mb, >)
+
+/* SPL creates a new task only if the warrior can afford to have more tasks.
+   Note that the new task is added at the end of the task queue *after* the
+   task that spawned it. This is a little detail that is crucial to the
+   correct operation of many a warrior out there. */
+#define EXEC_OP_SPL(q, ma, mb) \
+  { \
+    FETCH_OPERAND (mb, insn->b, addr_B, val_B); \
+    ADVANCE_PC (q, 1U); \
+    if (m->warriors[curr_warrior].num_tasks < m->max_prog_tasks) \
+    { \
+      add_task (m, &m->warriors[curr_warrior], addr_B); \
+      TASK_ADDED (q); \
+    } \
+    NEXT_TASK (); \
+  }
 
-      default:
+/* Defines the handler for OP, MA and MB in the set for Q. */
+#define DEFINE_HANDLER(q, op, ma, mb) \
+  HANDLER (q, op, ma, mb): \
+    EXEC_##op (q, ma, mb)
+
+/* Defines the handlers for OP in the set for Q. */
+#define DEFINE_HANDLERS(q, op) FOR_EACH_MODE_PAIR (DEFINE_HANDLER, q, op)
+
+
+/* Executes a battle in the simulator M, whose warriors have just been
+   loaded into its core. Returns the error code, the status of the battle in
+   STATUS, the user's wish in CMD and the warrior on whose task the simulation
+   ended in END_WARRIOR. */
+int
+exec_battle (mars_t *m, battle_status_t *status, user_wish_t *cmd,
+             unsigned int *end_warrior)
+{
+  int error = 0;
+
+  cell_addr_t mod_cell;
+
+  decoded_insn_t *insn;
+  cell_addr_t pc;
+  cell_addr_t addr_A, addr_B;
+  cell_addr_t val_A, val_B;
+
+  unsigned int alive_warriors = m->num_warriors;
+  unsigned int curr_warrior = 0U;
+  *end_warrior = curr_warrior;
+  unsigned int execed_insns = 0U;
+
+#ifdef ZINC_THREADED_DISPATCH
+  /* The sets of handlers, one after the other, and the set in use, indexed
+     by the handler of a predecoded instruction. */
+  static const void *const all_handlers[] =
+  {
+    HANDLER_SET_ADDRS (GENERAL)
+    HANDLER_SET_ADDRS (SINGLE)
+  };
+  const void *const *handlers;
+
+  /* The cycles up to which NEXT_TASK() can rotate to the next warrior by
+     itself. With at most two warriors, every loaded warrior is alive as
+     long as the battle is on. Updating the graphical interface however
+     needs the general rotation after every cycle. */
+  unsigned int fast_cycles
+    = (opt_no_gui == true && m->num_warriors <= 2U) ? m->max_cycles : 0U;
+#else
+  /* The first handler of the set in use. */
+  unsigned int queue_base;
+#endif
+
+  select_engine (m);
+  if (m->single_task == true)
+  {
+    USE_HANDLERS (SINGLE);
+  }
+  else
+  {
+    USE_HANDLERS (GENERAL);
+  }
+
+  /* The loader has just cleared the core to "DAT #0", which is also what
+     an all-zero predecoded instruction stands for, and written the warriors
+     into it. Only the cells holding the warriors need to be decoded. */
+  memset (m->decoded, 0, core_size * sizeof (decoded_insn_t));
+  for (unsigned int i = 0U; i < m->num_warriors; i++)
+  {
+    for (unsigned int j = 0U; j < m->warriors[i].num_insns; j++)
+    {
+      decode_cell (m, mod_add (m->warriors[i].load_addr, j));
+    }
+  }
+
+  while (execed_insns < m->max_cycles && *cmd == CONTINUE_BATTLE)
+  {
+    mod_cell = INVALID_CELL_ADDR;
+
+    if (m->warriors[curr_warrior].num_tasks > 0U)
+    {
+      // Fetch the predecoded instruction at the cell pointed to by the PC
+      // of the current task of the current warrior.
+      //
+      // We use a giant switch statement (or threaded code, see DISPATCH) to
+      // figure out what to do for a given opcode. An alternative would have
+      // been to use a table of pointers to decoder functions.
+
+      pc = CURR_TASK_PC (&m->warriors[curr_warrior]);
+      insn = &m->decoded[pc];
+      DISPATCH (insn->handler)
+      {
+      FOR_EACH_OPCODE (DEFINE_HANDLERS, GENERAL)
+
+      FOR_EACH_OPCODE (DEFINE_HANDLERS, SINGLE)
+
+      HANDLER_DEFAULT:
         fprintf (stderr,
-                 "Internal Error (invalid op-code %u) in exec_battle.\n",
-                 cell->op_code);
+                 "Internal Error (invalid instruction @%u) in exec_battle.\n",
+                 pc);
         error = 1;
         *cmd = QUIT_ZINC;
         *status = ZINC_FUBARED;
-        break;
-      }
-
-      if (*cmd == CONTINUE_BATTLE && warriors[curr_warrior].num_tasks > 1)
-      {
-        if (warriors[curr_warrior].tasks->next != NULL)
-        {
-          warriors[curr_warrior].tasks = warriors[curr_warrior].tasks->next;
-        }
-        else
-        {
-          fprintf (stderr,
-                   "Internal Error (invalid next task) in exec_battle.\n");
-          error = 1;
-          *cmd = QUIT_ZINC;
-          *status = ZINC_FUBARED;
-        }
+        END_TASK ();
       }
     }
 
+#ifdef ZINC_THREADED_DISPATCH
+  next_task:
+#endif
     /* We have executed yet another instruction. */
     execed_insns += 1U;
 
@@ -518,11 +786,12 @@ exec_battle (battle_status_t *status, user_wish_t *cmd,
       do
       {
         curr_warrior += 1U;
-        if (curr_warrior >= num_warriors)
+        if (curr_warrior >= m->num_warriors)
         {
           curr_warrior = 0U;
         }
-      } while (alive_warriors > 0U && warriors[curr_warrior].alive == false);
+      } while (alive_warriors > 0U
+               && m->warriors[curr_warrior].alive == false);
     }
 
     /* Update the user interface if the battle is still on. Note that we have
@@ -542,14 +811,14 @@ exec_battle (battle_status_t *status, user_wish_t *cmd,
     }
   }
 
-  if (execed_insns == max_cycles)
+  if (execed_insns == m->max_cycles)
   {
     *status = CYCLES_EXHAUSTED;
   }
 
   if (*status != USER_INTERRUPTED && *status != ZINC_FUBARED)
   {
-    update_scores ();
+    update_scores (m);
   }
 
   return error;
@@ -10,8 +10,12 @@
 #ifndef EXEC_H_INCLUDED
 #define EXEC_H_INCLUDED
 
+extern int exec_init (mars_t *m);
+
+extern void exec_free (mars_t *m);
+
 extern int
-exec_battle (battle_status_t *status, user_wish_t *cmd,
+exec_battle (mars_t *m, battle_status_t *status, user_wish_t *cmd,
              unsigned int *end_warrior);
 
 #endif /* EXEC_H_INCLUDED */
@@ -0,0 +1,624 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The king-of-the-hill mode. A hill is a set of warriors (the incumbents)
+  kept in a file together with the outcomes of the battles between every
+  pair of them. A new warrior (the challenger) only fights the incumbents,
+  since the outcomes of the other battles are already known. The warriors
+  are then ranked by their total scores and the warrior at the bottom is
+  pushed off the hill if the hill has grown too big.
+
+  The file is a text file with the following lines:
+
+    ZINC hill 1
+    settings CORE-SIZE MAX-CYCLES MAX-INSNS MAX-TASKS MIN-SEPARATION
+    size SIZE
+    rounds ROUNDS
+    seed SEED
+    warrior FILE
+    ...
+    record I J WINS LOSSES TIES
+    ...
+
+  with a "warrior" line for every incumbent, in the order in which they
+  joined the hill, and a "record" line for every pair of incumbents giving
+  the outcomes of the battles of the I-th incumbent against the J-th one,
+  counting from 0, where I < J.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zinc.h"
+#include "zasm.h"
+#include "tourney.h"
+#include "hill.h"
+
+/* The first line of a file holding a hill. */
+#define HILL_MAGIC "ZINC hill 1"
+
+/* The maximum number of characters in a line of a file holding a hill. */
+#define MAX_HILL_LINE_LEN (FILENAME_MAX + 64)
+
+/* The outcomes of the battles of a warrior against another. */
+typedef struct record
+{
+  uint32_t wins;
+  uint32_t losses;
+  uint32_t ties;
+} record_t;
+
+/* A hill. */
+typedef struct hill
+{
+  /* The maximum number of warriors kept on the hill. */
+  unsigned int size;
+
+  /* The number of battles between every pair of warriors. */
+  unsigned int num_rounds;
+
+  /* The seed for placing the warriors. */
+  uint64_t seed;
+
+  /* The number of warriors on the hill, including a challenger. */
+  unsigned int num_warriors;
+
+  /* The warriors on the hill, in the order in which they joined it, with
+     room for a challenger. */
+  warrior_t *warriors;
+
+  /* The outcomes of the battles of every warrior against every other, with
+     the record of the I-th warrior against the J-th one at I * (SIZE + 1)
+     + J. */
+  record_t *records;
+
+  /* The total score of every warrior against all the others. */
+  uint32_t *points;
+} hill_t;
+
+
+/* Returns the record of the I-th warrior on the hill H against the J-th
+   one. */
+static record_t *
+get_record (hill_t *h, unsigned int i, unsigned int j)
+{
+  return &h->records[i * (h->size + 1U) + j];
+}
+
+
+/* Returns the points scored in the battles given by the record R, as
+   awarded by update_scores() in exec.c to one of two warriors. */
+static uint32_t
+record_points (const record_t *r)
+{
+  return 3U * r->wins + r->ties;
+}
+
+
+/* Sets the record of the I-th warrior on the hill H against the J-th one
+   to R and the record of the J-th one against the I-th one to match. */
+static void
+set_records (hill_t *h, unsigned int i, unsigned int j, const record_t *r)
+{
+  record_t *rev = get_record (h, j, i);
+
+  *get_record (h, i, j) = *r;
+  rev->wins = r->losses;
+  rev->losses = r->wins;
+  rev->ties = r->ties;
+}
+
+
+/* Sets up the empty hill H to hold up to SIZE warriors. Returns 0 on
+   success and 1 on failure. */
+static int
+alloc_hill (hill_t *h, unsigned int size)
+{
+  int error = 0;
+
+  h->size = size;
+  h->num_warriors = 0U;
+  h->warriors = (warrior_t *)calloc (size + 1U, sizeof (warrior_t));
+  h->records
+    = (record_t *)calloc ((size + 1U) * (size + 1U), sizeof (record_t));
+  h->points = (uint32_t *)calloc (size + 1U, sizeof (uint32_t));
+  if (h->warriors == NULL || h->records == NULL || h->points == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for the hill.\n\n");
+    error = 1;
+  }
+
+  return error;
+}
+
+
+/* Frees the memory held by the hill H. */
+static void
+free_hill (hill_t *h)
+{
+  free (h->warriors);
+  free (h->records);
+  free (h->points);
+}
+
+
+/* Adds the warrior in the file FILE to the hill H and assembles it. The
+   file name is copied. Returns 0 on success and 1 on failure. */
+static int
+add_incumbent (hill_t *h, const char *file)
+{
+  int error = 0;
+  warrior_t *w = &h->warriors[h->num_warriors];
+
+  memset (w, 0, sizeof (warrior_t));
+  w->file = (char *)malloc (strlen (file) + 1U);
+  if (w->file == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for the hill.\n\n");
+    error = 1;
+  }
+  else
+  {
+    strcpy (w->file, file);
+    w->id = UNKNOWN_WARRIOR + h->num_warriors + 1U;
+    error = assemble_warrior (w);
+  }
+
+  if (error == 0)
+  {
+    if (w->name == NULL)
+    {
+      w->name = w->file;
+    }
+    h->num_warriors++;
+  }
+
+  return error;
+}
+
+
+/* Reads the hill H from the file FILE. If there is no such file, a new
+   hill is started with room for SIZE warriors, NUM_ROUNDS battles between
+   every pair of them and the seed SEED. Returns 0 on success and 1 on
+   failure. */
+static int
+read_hill (hill_t *h, const char *file, unsigned int size,
+           unsigned int num_rounds, uint64_t seed)
+{
+  int error = 0;
+  char line[MAX_HILL_LINE_LEN + 1];
+  unsigned int settings[5] = { 0U, 0U, 0U, 0U, 0U };
+  unsigned long long stored_seed = 0U;
+  FILE *in = fopen (file, "r");
+
+  h->num_rounds = num_rounds;
+  h->seed = seed;
+
+  if (in == NULL)
+  {
+    printf ("Starting a new hill in \"%s\".\n\n", file);
+    error = alloc_hill (h, size);
+  }
+  else if (fgets (line, sizeof (line), in) == NULL
+           || strncmp (line, HILL_MAGIC, strlen (HILL_MAGIC)) != 0
+           || fgets (line, sizeof (line), in) == NULL
+           || sscanf (line, "settings %u %u %u %u %u", &settings[0],
+                      &settings[1], &settings[2], &settings[3],
+                      &settings[4]) != 5
+           || fgets (line, sizeof (line), in) == NULL
+           || sscanf (line, "size %u", &size) != 1 || size == 0U
+           || fgets (line, sizeof (line), in) == NULL
+           || sscanf (line, "rounds %u", &h->num_rounds) != 1
+           || h->num_rounds == 0U
+           || fgets (line, sizeof (line), in) == NULL
+           || sscanf (line, "seed %llu", &stored_seed) != 1)
+  {
+    fprintf (stderr, "ERROR: \"%s\" does not hold a hill.\n\n", file);
+    error = 1;
+  }
+  else if (settings[0] != core_size || settings[1] != max_cycles
+           || settings[2] != max_prog_insns || settings[3] != max_prog_tasks
+           || settings[4] != min_prog_separation)
+  {
+    fprintf (stderr, "ERROR: The hill in \"%s\" was played with other "
+             "settings.\n\n", file);
+    error = 1;
+  }
+  else
+  {
+    h->seed = stored_seed;
+    error = alloc_hill (h, size);
+  }
+
+  while (error == 0 && in != NULL && fgets (line, sizeof (line), in) != NULL)
+  {
+    size_t len = strlen (line);
+    unsigned int i, j;
+    record_t r;
+
+    if (len > 0U && line[len - 1U] == '\n')
+    {
+      line[len - 1U] = '\0';
+    }
+
+    if (strncmp (line, "warrior ", 8U) == 0 && h->num_warriors < h->size)
+    {
+      error = add_incumbent (h, line + 8);
+    }
+    else if (sscanf (line, "record %u %u %" SCNu32 " %" SCNu32 " %" SCNu32,
+                     &i, &j, &r.wins, &r.losses, &r.ties) == 5
+             && i < j && j < h->num_warriors)
+    {
+      set_records (h, i, j, &r);
+      h->points[i] += record_points (get_record (h, i, j));
+      h->points[j] += record_points (get_record (h, j, i));
+    }
+    else
+    {
+      fprintf (stderr, "ERROR: Bad line \"%s\" in the hill in \"%s\".\n\n",
+               line, file);
+      error = 1;
+    }
+  }
+
+  if (in != NULL)
+  {
+    fclose (in);
+  }
+
+  return error;
+}
+
+
+/* Writes the hill H to the file FILE. The hill is first written to a
+   temporary file which then replaces FILE, so that FILE always holds a
+   complete hill. Returns 0 on success and 1 on failure. */
+static int
+write_hill (hill_t *h, const char *file)
+{
+  int error = 0;
+  char *tmp_file = (char *)malloc (strlen (file) + 5U);
+  FILE *out = NULL;
+
+  if (tmp_file == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for the hill.\n\n");
+    error = 1;
+  }
+  else
+  {
+    sprintf (tmp_file, "%s.tmp", file);
+    out = fopen (tmp_file, "w");
+  }
+
+  if (error == 0 && out == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to write to \"%s\".\n\n", tmp_file);
+    error = 1;
+  }
+  else if (error == 0)
+  {
+    fprintf (out, "%s\n", HILL_MAGIC);
+    fprintf (out, "settings %u %u %u %u %u\n", core_size, max_cycles,
+             max_prog_insns, max_prog_tasks, min_prog_separation);
+    fprintf (out, "size %u\n", h->size);
+    fprintf (out, "rounds %u\n", h->num_rounds);
+    fprintf (out, "seed %" PRIu64 "\n", h->seed);
+
+    for (unsigned int i = 0U; i < h->num_warriors; i++)
+    {
+      fprintf (out, "warrior %s\n", h->warriors[i].file);
+    }
+
+    for (unsigned int i = 0U; i < h->num_warriors; i++)
+    {
+      for (unsigned int j = i + 1U; j < h->num_warriors; j++)
+      {
+        record_t *r = get_record (h, i, j);
+
+        fprintf (out, "record %u %u %" PRIu32 " %" PRIu32 " %" PRIu32 "\n",
+                 i, j, r->wins, r->losses, r->ties);
+      }
+    }
+
+    if (fclose (out) != 0)
+    {
+      fprintf (stderr, "ERROR: Unable to write to \"%s\".\n\n", tmp_file);
+      error = 1;
+    }
+  }
+
+  /* Some systems do not let an existing file be replaced by renaming. */
+  if (error == 0 && rename (tmp_file, file) != 0
+      && (remove (file) != 0 || rename (tmp_file, file) != 0))
+  {
+    fprintf (stderr, "ERROR: Unable to write to \"%s\".\n\n", file);
+    error = 1;
+  }
+
+  free (tmp_file);
+
+  return error;
+}
+
+
+/* Plays the challenger, the last warrior on the hill H, against the
+   incumbents and adds the outcomes to the records and the scores of the
+   warriors. If TOP is not 0, the incumbents are played one at a time and
+   *REJECTED is set to true as soon as at least TOP incumbents are sure to
+   end up with at least as many points as the most that the challenger
+   could still get, which is then not played against the rest of them.
+   The number of incumbents played is stored in NUM_PLAYED. Returns 0 on
+   success and 1 on failure. */
+static int
+play_challenger (hill_t *h, unsigned int num_threads, unsigned int top,
+                 bool *rejected, unsigned int *num_played)
+{
+  int error = 0;
+  unsigned int c = h->num_warriors - 1U;
+  unsigned int step = (top == 0U) ? c : 1U;
+  unsigned int played = 0U;
+  record_t none = { 0U, 0U, 0U };
+  record_t all_wins = { h->num_rounds, 0U, 0U };
+  pairing_t *pairings = (pairing_t *)malloc (c * sizeof (pairing_t));
+  uint32_t (*scores)[2]
+    = (uint32_t (*)[2])malloc ((uint64_t )c * h->num_rounds
+                               * sizeof (uint32_t[2]));
+
+  *rejected = false;
+  if (c > 0U && (pairings == NULL || scores == NULL))
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for battles.\n\n");
+    error = 1;
+  }
+
+  if (error == 0)
+  {
+    /* When the challenger may be rejected, the incumbents are played from
+       the highest score down, which brings the most that the challenger
+       could still get down the fastest. An insertion sort does for the
+       few warriors on a hill. */
+    for (unsigned int i = 0U; i < c; i++)
+    {
+      unsigned int j = i;
+
+      while (top != 0U && j > 0U
+             && h->points[pairings[j - 1U].second] < h->points[i])
+      {
+        pairings[j] = pairings[j - 1U];
+        j--;
+      }
+      pairings[j].first = c;
+      pairings[j].second = i;
+      set_records (h, c, i, &none);
+    }
+  }
+
+  h->points[c] = 0U;
+  while (error == 0 && played < c && *rejected == false)
+  {
+    unsigned int n = (c - played < step) ? c - played : step;
+
+    error = tourney_play (h->warriors, &pairings[played], n, h->num_rounds,
+                          num_threads, h->seed, 0U, false, scores);
+
+    for (unsigned int p = 0U; error == 0 && p < n; p++)
+    {
+      unsigned int i = pairings[played + p].second;
+      record_t r = { 0U, 0U, 0U };
+
+      for (unsigned int k = 0U; k < h->num_rounds; k++)
+      {
+        uint32_t *s = scores[p * h->num_rounds + k];
+
+        if (s[0] > s[1])
+        {
+          r.wins++;
+        }
+        else if (s[0] < s[1])
+        {
+          r.losses++;
+        }
+        else
+        {
+          r.ties++;
+        }
+      }
+
+      set_records (h, c, i, &r);
+      h->points[c] += record_points (get_record (h, c, i));
+      h->points[i] += record_points (get_record (h, i, c));
+    }
+    played += n;
+
+    /* The points of an incumbent can only go up, and those of the
+       challenger by no more than a win in every battle left. */
+    if (error == 0 && top != 0U)
+    {
+      uint64_t most = h->points[c]
+                      + (uint64_t )(c - played) * record_points (&all_wins);
+      unsigned int num_above = 0U;
+
+      for (unsigned int i = 0U; i < c; i++)
+      {
+        if (h->points[i] >= most)
+        {
+          num_above++;
+        }
+      }
+      *rejected = (num_above >= top);
+    }
+  }
+
+  *num_played = played;
+
+  free (pairings);
+  free (scores);
+
+  return error;
+}
+
+
+/* Removes the I-th warrior from the hill H, taking its points away from
+   the other warriors. */
+static void
+evict_warrior (hill_t *h, unsigned int i)
+{
+  unsigned int n = h->num_warriors;
+
+  for (unsigned int j = 0U; j < n; j++)
+  {
+    if (j != i)
+    {
+      h->points[j] -= record_points (get_record (h, j, i));
+    }
+  }
+
+  for (unsigned int j = i; j + 1U < n; j++)
+  {
+    h->warriors[j] = h->warriors[j + 1U];
+    h->points[j] = h->points[j + 1U];
+  }
+
+  for (unsigned int j = 0U; j + 1U < n; j++)
+  {
+    for (unsigned int k = 0U; k + 1U < n; k++)
+    {
+      *get_record (h, j, k)
+        = *get_record (h, j + (j >= i), k + (k >= i));
+    }
+  }
+
+  h->num_warriors--;
+}
+
+
+/* Prints out the warriors on the hill H ranked by their scores, with a
+   warrior that joined the hill earlier ranked above one with the same
+   score that joined it later. */
+static void
+print_hill (hill_t *h)
+{
+  unsigned int *ranks
+    = (unsigned int *)malloc (h->num_warriors * sizeof (unsigned int));
+
+  /* An insertion sort does for the few warriors on a hill. */
+  for (unsigned int i = 0U; ranks != NULL && i < h->num_warriors; i++)
+  {
+    unsigned int j = i;
+
+    while (j > 0U && h->points[ranks[j - 1U]] < h->points[i])
+    {
+      ranks[j] = ranks[j - 1U];
+      j--;
+    }
+    ranks[j] = i;
+  }
+
+  printf ("Hill:\n");
+  for (unsigned int r = 0U; ranks != NULL && r < h->num_warriors; r++)
+  {
+    unsigned int i = ranks[r];
+    record_t total = { 0U, 0U, 0U };
+
+    for (unsigned int j = 0U; j < h->num_warriors; j++)
+    {
+      if (j != i)
+      {
+        total.wins += get_record (h, i, j)->wins;
+        total.losses += get_record (h, i, j)->losses;
+        total.ties += get_record (h, i, j)->ties;
+      }
+    }
+
+    printf ("%4u. \"%s\" - %" PRIu32 " (%" PRIu32 "/%" PRIu32 "/%" PRIu32
+            ")\n", r + 1U, h->warriors[i].name, h->points[i], total.wins,
+            total.losses, total.ties);
+  }
+
+  free (ranks);
+}
+
+
+/* Challenges the hill kept in the file FILE with each of the NUM_CHALLENGERS
+   warriors in CHALLENGERS in turn, running up to NUM_THREADS battles at
+   once, and writes the updated hill back to FILE. A new hill holds up to
+   SIZE warriors, which play NUM_ROUNDS battles against each other with the
+   placements given by SEED. An existing hill keeps its own settings. If
+   TOP is not 0, a challenger that cannot make the top TOP warriors on the
+   hill stops playing as soon as that is known and does not join the hill.
+   Returns 0 on success and 1 on failure. */
+int
+hill_challenge (const char *file, unsigned int size, unsigned int num_rounds,
+                unsigned int num_threads, uint64_t seed,
+                const warrior_t *challengers, unsigned int num_challengers,
+                unsigned int top)
+{
+  int error = 0;
+  hill_t hill;
+
+  memset (&hill, 0, sizeof (hill_t));
+  error = read_hill (&hill, file, size, num_rounds, seed);
+
+  for (unsigned int i = 0U; error == 0 && i < num_challengers; i++)
+  {
+    unsigned int c = hill.num_warriors;
+
+    hill.warriors[c] = challengers[i];
+    hill.warriors[c].id = UNKNOWN_WARRIOR + c + 1U;
+    hill.num_warriors++;
+
+    bool rejected = false;
+    unsigned int num_played = 0U;
+
+    printf ("Challenger: \"%s\"\n", challengers[i].name);
+    error = play_challenger (&hill, num_threads, top, &rejected,
+                             &num_played);
+
+    if (error == 0 && rejected == true)
+    {
+      printf ("\"%s\" cannot make the top %u after playing %u of %u "
+              "incumbents.\n", hill.warriors[c].name, top, num_played, c);
+      evict_warrior (&hill, c);
+    }
+    else if (error == 0 && hill.num_warriors > hill.size)
+    {
+      unsigned int loser = 0U;
+
+      /* The newer of two warriors with the same score is pushed off. */
+      for (unsigned int j = 1U; j < hill.num_warriors; j++)
+      {
+        if (hill.points[j] <= hill.points[loser])
+        {
+          loser = j;
+        }
+      }
+
+      printf ("\"%s\" was pushed off the hill.\n",
+              hill.warriors[loser].name);
+      evict_warrior (&hill, loser);
+    }
+
+    if (error == 0)
+    {
+      print_hill (&hill);
+      printf ("\n");
+    }
+  }
+
+  if (error == 0)
+  {
+    error = write_hill (&hill, file);
+  }
+
+  free_hill (&hill);
+
+  return error;
+}
@@ -0,0 +1,22 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the king-of-the-hill mode.
+*/
+
+#ifndef HILL_H_INCLUDED
+#define HILL_H_INCLUDED
+
+/* The default number of warriors kept on a hill. */
+#define DEFAULT_HILL_SIZE 10U
+
+extern int
+hill_challenge (const char *file, unsigned int size, unsigned int num_rounds,
+                unsigned int num_threads, uint64_t seed,
+                const warrior_t *challengers, unsigned int num_challengers,
+                unsigned int top);
+
+#endif /* HILL_H_INCLUDED */
@@ -0,0 +1,208 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The creation and destruction of simulators and the loading of warriors
+  into them.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zinc.h"
+#include "mars.h"
+#include "core.h"
+#include "exec.h"
+
+
+/* Sets up the simulator M for battles between the NUM_WARRIORS assembled
+   warriors in WARRIORS, with the limits currently in effect. Returns 0 on
+   success and 1 on failure, in which case M must still be freed with
+   mars_free(). */
+int
+mars_init (mars_t *m, const warrior_t *warriors, unsigned int num_warriors)
+{
+  int error = 0;
+
+  memset (m, 0, sizeof (mars_t));
+  m->num_warriors = num_warriors;
+  m->max_cycles = max_cycles;
+  m->max_prog_insns = max_prog_insns;
+  m->max_prog_tasks = max_prog_tasks;
+
+  /* The task queues are allocated once and reused for every battle. */
+  for (unsigned int i = 0U; i < num_warriors; i++)
+  {
+    mars_enlist (m, i, &warriors[i]);
+    m->warriors[i].task_pcs
+      = (cell_addr_t *)malloc (m->max_prog_tasks * sizeof (cell_addr_t));
+    if (m->warriors[i].task_pcs == NULL)
+    {
+      fprintf (stderr, "ERROR: Unable to allocate memory for tasks.\n\n");
+      error = 1;
+    }
+  }
+
+  if (error == 0 && alloc_core (m) != 0)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for core.\n\n");
+    error = 1;
+  }
+
+  if (error == 0 && exec_init (m) != 0)
+  {
+    error = 1;
+  }
+
+  return error;
+}
+
+
+/* Frees the memory held by the simulator M. */
+void
+mars_free (mars_t *m)
+{
+  exec_free (m);
+  free_core (m);
+
+  for (unsigned int i = 0U; i < m->num_warriors; i++)
+  {
+    free (m->warriors[i].task_pcs);
+    m->warriors[i].task_pcs = NULL;
+  }
+}
+
+
+/* Puts the assembled warrior W into the slot SLOT of the simulator M for
+   the following battles, keeping the task queue of the slot and clearing
+   its score. */
+void
+mars_enlist (mars_t *m, unsigned int slot, const warrior_t *w)
+{
+  cell_addr_t *task_pcs = m->warriors[slot].task_pcs;
+
+  m->warriors[slot] = *w;
+  m->warriors[slot].id = UNKNOWN_WARRIOR + slot + 1U;
+  m->warriors[slot].task_pcs = task_pcs;
+  m->warriors[slot].score = 0U;
+}
+
+
+/* Loads the warrior in the slot I of the simulator M into its core at the
+   address START_ADDR. */
+static void
+load_warrior (mars_t *m, unsigned int i, cell_addr_t start_addr)
+{
+  warrior_t *w = &m->warriors[i];
+
+  w->load_addr = start_addr;
+  w->alive = true;
+  w->num_tasks = 1U;
+  w->curr_task = 0U;
+  w->task_pcs[0] = (start_addr + w->init_pc) % core_size;
+
+  for (unsigned int j = 0U; j < w->num_insns; j++)
+  {
+    cell_addr_t addr = (start_addr + j) % core_size;
+
+    MARK_CELL (m, addr, w->id);
+    SET_CELL_INSN (m, addr, w->insns[j].op_code, w->insns[j].mode_a,
+                   w->insns[j].mode_b);
+    CELL_OP_A (m, addr) = w->insns[j].op_a;
+    CELL_OP_B (m, addr) = w->insns[j].op_b;
+  }
+}
+
+
+/* Loads the warrior programmes of the simulator M into its core at random
+   places. */
+void
+mars_load (mars_t *m)
+{
+  cell_addr_t avail_range = core_size, prev_addr = 0U;
+
+  /* Initialise all the cells of the core to "DAT #0". */
+  clear_core (m);
+
+  /* Load the warriors into the core. */
+  for (unsigned int i = 0U; i < m->num_warriors; i++)
+  {
+    cell_addr_t start_addr
+      = ((prev_addr + m->max_prog_insns) + (mars_rand (m) % avail_range))
+        % core_size;
+
+    prev_addr = start_addr;
+    avail_range -= (2 * m->max_prog_insns);
+    load_warrior (m, i, start_addr);
+  }
+
+  mirror_core (m);
+}
+
+
+/* Loads the warrior programmes of the simulator M into its core with the
+   warrior in every slot starting at the address for the slot in
+   START_ADDRS. */
+void
+mars_load_at (mars_t *m, const cell_addr_t start_addrs[])
+{
+  clear_core (m);
+  for (unsigned int i = 0U; i < m->num_warriors; i++)
+  {
+    load_warrior (m, i, start_addrs[i]);
+  }
+  mirror_core (m);
+}
+
+
+/* The increment of the state of the random number generator. */
+#define RNG_GAMMA UINT64_C (0x9E3779B97F4A7C15)
+
+
+/* Scrambles the bits of Z. */
+static uint64_t
+rng_mix (uint64_t z)
+{
+  z = (z ^ (z >> 30)) * UINT64_C (0xBF58476D1CE4E5B9);
+  z = (z ^ (z >> 27)) * UINT64_C (0x94D049BB133111EB);
+
+  return z ^ (z >> 31);
+}
+
+
+/* Seeds the random number generator of the simulator M for the round
+   ROUND of a series of battles played with the seed SEED. Every round gets
+   a sequence of its own, so the placements in a round do not depend on
+   which simulator plays it or on the rounds it played before. */
+void
+mars_seed (mars_t *m, uint64_t seed, unsigned int round)
+{
+  m->rng_state = rng_mix (seed + ((uint64_t )round + 1U) * RNG_GAMMA);
+}
+
+
+/* Returns the next number from the random number generator with the
+   state STATE. This is SplitMix64 (see "Fast Splittable Pseudorandom Number
+   Generators" by Steele, Lea and Flood), which needs no more state than a
+   counter and whose sequences are the same on every platform. */
+uint32_t
+rng_next (uint64_t *state)
+{
+  *state += RNG_GAMMA;
+
+  return (uint32_t )(rng_mix (*state) >> 32);
+}
+
+
+/* Returns the next number from the random number generator of the
+   simulator M. */
+uint32_t
+mars_rand (mars_t *m)
+{
+  return rng_next (&m->rng_state);
+}
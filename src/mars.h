@@ -0,0 +1,82 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The context of a simulator.
+*/
+
+#ifndef MARS_H_INCLUDED
+#define MARS_H_INCLUDED
+
+/* A predecoded instruction (see exec.c). */
+struct decoded_insn;
+
+/* A simulator with everything needed to run battles between a set of
+   warriors: the core, the state of the warriors, the limits of a battle
+   and a random number generator for placing the warriors. Every simulator
+   is independent of all the others, so battles can run in as many of them
+   at once as needed.
+
+   The size of the core is the same for all the simulators, since the
+   warriors are assembled for it (see normalise). */
+typedef struct mars
+{
+  /* The core (see core.h). */
+#ifdef ZINC_SPLIT_CORE
+  cell_addr_t *core_op_a;
+  cell_addr_t *core_op_b;
+  uint8_t *core_insn;
+  warrior_id_t *core_marker;
+#else
+  cell_t *core;
+#endif
+
+  /* The predecoded shadow of the core (see exec.c). */
+  struct decoded_insn *decoded;
+
+  /* Whether every warrior in the current battle runs a single task
+     throughout, so that its task queue can be left alone. */
+  bool single_task;
+
+  /* The number of warriors. */
+  unsigned int num_warriors;
+
+  /* The warriors. Their assembled programmes are shared with the warriors
+     they were made from, but their task queues and scores are not. */
+  warrior_t warriors[MAX_WARRIORS];
+
+  /* The maximum number of cycles in a battle. */
+  unsigned int max_cycles;
+
+  /* The maximum number of instructions in a warrior, used for keeping the
+     warriors apart when they are loaded. */
+  unsigned int max_prog_insns;
+
+  /* The maximum number of tasks allowed per warrior. */
+  unsigned int max_prog_tasks;
+
+  /* The state of the random number generator. */
+  uint64_t rng_state;
+} mars_t;
+
+extern int
+mars_init (mars_t *m, const warrior_t *warriors, unsigned int num_warriors);
+
+extern void mars_free (mars_t *m);
+
+extern void
+mars_enlist (mars_t *m, unsigned int slot, const warrior_t *w);
+
+extern void mars_load (mars_t *m);
+
+extern void mars_load_at (mars_t *m, const cell_addr_t start_addrs[]);
+
+extern void mars_seed (mars_t *m, uint64_t seed, unsigned int round);
+
+extern uint32_t mars_rand (mars_t *m);
+
+extern uint32_t rng_next (uint64_t *state);
+
+#endif /* MARS_H_INCLUDED */
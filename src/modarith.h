@@ -0,0 +1,86 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  Modulo arithmetic on the addresses and values of cells in the core.
+*/
+
+#ifndef MODARITH_H_INCLUDED
+#define MODARITH_H_INCLUDED
+
+/* If ZINC_FIXED_CORE_SIZE is defined, ZINC only supports a core with
+   DEFAULT_CORE_SIZE cells and the compiler can do all the arithmetic below
+   with constants. Otherwise it uses the core size chosen at run time and
+   its reciprocal as computed by mod_init(). */
+#ifdef ZINC_FIXED_CORE_SIZE
+#define MOD_SIZE DEFAULT_CORE_SIZE
+#define MOD_RECIP (UINT32_MAX / DEFAULT_CORE_SIZE + 1U)
+#else
+#define MOD_SIZE core_size
+#define MOD_RECIP core_size_recip
+#endif
+
+/* The reciprocal of the size of the core scaled by 2 to the power of 32 and
+   rounded up, used by mod_reduce(). */
+extern uint32_t core_size_recip;
+
+extern int mod_init (void);
+
+/* Marks the condition C as being rarely true. Sums and differences of
+   addresses only occasionally wrap around the end of the core, so a
+   well-predicted branch costs less than computing a conditional correction
+   on every instruction. */
+#ifdef __GNUC__
+#define MOD_RARELY(c) __builtin_expect (!!(c), 0)
+#else
+#define MOD_RARELY(c) (c)
+#endif
+
+
+/* Returns (A + B) modulo the core size, where A and B are already
+   within 0 to the core size - 1. */
+static inline cell_addr_t
+mod_add (cell_addr_t a, cell_addr_t b)
+{
+  uint32_t sum = (uint32_t )a + (uint32_t )b;
+
+  if (MOD_RARELY (sum >= MOD_SIZE))
+  {
+    sum -= MOD_SIZE;
+  }
+
+  return (cell_addr_t )sum;
+}
+
+
+/* Returns (A - B) modulo the core size, where A and B are already
+   within 0 to the core size - 1. */
+static inline cell_addr_t
+mod_sub (cell_addr_t a, cell_addr_t b)
+{
+  uint32_t diff = (uint32_t )a - (uint32_t )b;
+
+  if (MOD_RARELY (a < b))
+  {
+    diff += MOD_SIZE;
+  }
+
+  return (cell_addr_t )diff;
+}
+
+
+/* Returns X modulo the core size for any X that fits in a cell_addr_t,
+   without a division. This is exact since both X and the core size fit in
+   16 bits and the reciprocal has 32 bits of fraction (see "Faster
+   Remainder by Direct Computation" by Lemire, Kaser and Kurz). */
+static inline cell_addr_t
+mod_reduce (uint32_t x)
+{
+  uint32_t frac = MOD_RECIP * x;
+
+  return (cell_addr_t )(((uint64_t )frac * MOD_SIZE) >> 32);
+}
+
+#endif /* MODARITH_H_INCLUDED */
@@ -0,0 +1,286 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  A pool of worker threads that share out a number of units of work. Every
+  worker has a context of its own (for example, a simulator), so a unit of
+  work can be done by any worker without any locking.
+
+  The units are dealt out to the workers up front as ranges of consecutive
+  units of about the same size. A worker does the units in its own range
+  in order and, once it runs out of them, steals the latter half of the
+  units left in the range of another worker. Units of work can take very
+  different times (a battle can be over in a few cycles or go on till the
+  cycles run out), so no worker is left idle while others still have a
+  backlog, yet workers seldom contend for the same range.
+*/
+
+/* POSIX threads are not part of C99. */
+#ifdef ZINC_THREADS
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef ZINC_THREADS
+#include <pthread.h>
+#endif
+
+#include "pool.h"
+
+#ifdef ZINC_THREADS
+const bool pool_threaded = true;
+#else
+const bool pool_threaded = false;
+#endif
+
+struct worker;
+
+/* The units of work being shared out. */
+typedef struct pool
+{
+  /* What to do for every unit of work. */
+  pool_work_t work;
+
+  /* The argument shared by all the workers. */
+  void *arg;
+
+  /* The workers. */
+  struct worker *workers;
+
+  /* The number of workers. */
+  unsigned int num_workers;
+
+  /* Whether any unit of work has failed, in which case the workers stop
+     taking up new units. */
+  bool failed;
+
+#ifdef ZINC_THREADS
+  /* Guards FAILED. */
+  pthread_mutex_t lock;
+#endif
+} pool_t;
+
+/* A worker in a pool. */
+typedef struct worker
+{
+  pool_t *pool;
+
+  /* The context of the worker. */
+  void *ctx;
+
+  /* The range of units of work yet to be taken up by the worker, from
+     NEXT_UNIT up to but not including END_UNIT. */
+  unsigned int next_unit;
+  unsigned int end_unit;
+
+#ifdef ZINC_THREADS
+  /* Guards NEXT_UNIT and END_UNIT. */
+  pthread_mutex_t lock;
+#endif
+} worker_t;
+
+
+/* Lock and unlock the mutex LOCK, if there are threads. */
+#ifdef ZINC_THREADS
+#define LOCK(lock) pthread_mutex_lock (&(lock))
+#define UNLOCK(lock) pthread_mutex_unlock (&(lock))
+#else
+#define LOCK(lock) ((void )0)
+#define UNLOCK(lock) ((void )0)
+#endif
+
+
+/* Takes up the next unit of work in the range of the worker W into UNIT.
+   Returns false if its range is empty. */
+static bool
+take_own_unit (worker_t *w, unsigned int *unit)
+{
+  bool ret_val = false;
+
+  LOCK (w->lock);
+  if (w->next_unit < w->end_unit)
+  {
+    *unit = w->next_unit;
+    w->next_unit += 1U;
+    ret_val = true;
+  }
+  UNLOCK (w->lock);
+
+  return ret_val;
+}
+
+
+/* Moves the latter half of the units of work left with another worker in
+   the pool of the worker W into the range of W, trying the other workers
+   in turn. Returns false if none of them has any units left. */
+static bool
+steal_units (worker_t *w)
+{
+  bool ret_val = false;
+  pool_t *p = w->pool;
+  unsigned int self = (unsigned int )(w - p->workers);
+
+  for (unsigned int i = 1U; ret_val == false && i < p->num_workers; i++)
+  {
+    worker_t *victim = &p->workers[(self + i) % p->num_workers];
+    unsigned int begin = 0U, end = 0U;
+
+    LOCK (victim->lock);
+    if (victim->next_unit < victim->end_unit)
+    {
+      end = victim->end_unit;
+      begin = end - (end - victim->next_unit + 1U) / 2U;
+      victim->end_unit = begin;
+      ret_val = true;
+    }
+    UNLOCK (victim->lock);
+
+    /* The range of W is empty, so another worker can only have looked at
+       it in the meanwhile, not changed it. */
+    if (ret_val == true)
+    {
+      LOCK (w->lock);
+      w->next_unit = begin;
+      w->end_unit = end;
+      UNLOCK (w->lock);
+    }
+  }
+
+  return ret_val;
+}
+
+
+/* Returns whether a unit of work in the pool P has failed. */
+static bool
+has_failed (pool_t *p)
+{
+  bool ret_val;
+
+  LOCK (p->lock);
+  ret_val = p->failed;
+  UNLOCK (p->lock);
+
+  return ret_val;
+}
+
+
+/* Does units of work for the worker W, given as a void pointer for
+   pthread_create(), until there are none left. */
+static void *
+run_worker (void *w)
+{
+  worker_t *worker = (worker_t *)w;
+  pool_t *p = worker->pool;
+  unsigned int unit;
+
+  while (has_failed (p) == false
+         && (take_own_unit (worker, &unit)
+             || (steal_units (worker) && take_own_unit (worker, &unit))))
+  {
+    if (p->work (worker->ctx, unit, p->arg) != 0)
+    {
+      LOCK (p->lock);
+      p->failed = true;
+      UNLOCK (p->lock);
+    }
+  }
+
+  return NULL;
+}
+
+
+/* Does the NUM_UNITS units of work numbered from 0 by calling WORK for each
+   of them with the argument ARG, using up to NUM_WORKERS workers with the
+   contexts in CTXS. The first worker runs in the calling thread. Units may
+   be done in any order and a unit must not depend on another. Returns 0 on
+   success and 1 if any unit of work failed. */
+int
+pool_run (unsigned int num_workers, void *ctxs[], unsigned int num_units,
+          pool_work_t work, void *arg)
+{
+  int error = 0;
+  pool_t pool;
+  worker_t *workers
+    = (worker_t *)malloc (num_workers * sizeof (worker_t));
+
+  if (workers == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for workers.\n");
+    error = 1;
+  }
+  else
+  {
+    pool.work = work;
+    pool.arg = arg;
+    pool.workers = workers;
+    pool.num_workers = num_workers;
+    pool.failed = false;
+
+    for (unsigned int i = 0U; i < num_workers; i++)
+    {
+      workers[i].pool = &pool;
+      workers[i].ctx = ctxs[i];
+      workers[i].next_unit
+        = (unsigned int )((uint64_t )num_units * i / num_workers);
+      workers[i].end_unit
+        = (unsigned int )((uint64_t )num_units * (i + 1U) / num_workers);
+    }
+
+#ifdef ZINC_THREADS
+    pthread_t *threads
+      = (pthread_t *)malloc (num_workers * sizeof (pthread_t));
+    unsigned int num_threads = 0U;
+
+    pthread_mutex_init (&pool.lock, NULL);
+    for (unsigned int i = 0U; i < num_workers; i++)
+    {
+      pthread_mutex_init (&workers[i].lock, NULL);
+    }
+
+    /* If a thread cannot be created, the workers that are running will
+       steal its units. */
+    if (threads != NULL)
+    {
+      for (unsigned int i = 1U; i < num_workers; i++)
+      {
+        if (pthread_create (&threads[num_threads], NULL, run_worker,
+                            &workers[i]) == 0)
+        {
+          num_threads++;
+        }
+      }
+    }
+#endif
+
+    run_worker (&workers[0]);
+
+#ifdef ZINC_THREADS
+    for (unsigned int i = 0U; i < num_threads; i++)
+    {
+      pthread_join (threads[i], NULL);
+    }
+
+    for (unsigned int i = 0U; i < num_workers; i++)
+    {
+      pthread_mutex_destroy (&workers[i].lock);
+    }
+    pthread_mutex_destroy (&pool.lock);
+    free (threads);
+#endif
+
+    if (pool.failed == true)
+    {
+      error = 1;
+    }
+
+    free (workers);
+  }
+
+  return error;
+}
@@ -0,0 +1,25 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the pool of worker threads.
+*/
+
+#ifndef POOL_H_INCLUDED
+#define POOL_H_INCLUDED
+
+/* Does the unit of work UNIT using the context CTX of the worker doing it
+   and the argument ARG shared by all the workers. Returns 0 on success and
+   a non-zero value on failure. */
+typedef int (*pool_work_t) (void *ctx, unsigned int unit, void *arg);
+
+/* Whether more than one worker can run at a time. */
+extern const bool pool_threaded;
+
+extern int
+pool_run (unsigned int num_workers, void *ctxs[], unsigned int num_units,
+          pool_work_t work, void *arg);
+
+#endif /* POOL_H_INCLUDED */
@@ -16,13 +16,18 @@
 #include <SDL.h>
 
 #include "zinc.h"
+#include "mars.h"
 #include "dump.h"
 #include "sdlui.h"
 #include "sdltxt.h"
+#include "core.h"
 
 /* The surface representing the user interface. */
 static SDL_Surface *screen = NULL;
 
+/* The simulator whose battles are shown. */
+static mars_t *mars = NULL;
+
 /* A flag that indicates if we are paused or not. */
 static bool paused;
 
@@ -118,7 +123,7 @@ static char *inspecting_stat_msg
 static void
 draw_cell (cell_addr_t c)
 {
-  warrior_id_t marker = core[c].marker;
+  warrior_id_t marker = CELL_MARKER (mars, c);
 
   SDL_Rect rect;
   rect.x = core_rect.x + (cell_size + 2) * (c % num_x_cells) + 1;
@@ -291,9 +296,9 @@ draw_pc_ind (unsigned int curr_warrior)
     draw_box (x, y, w, h, bg_clr_num);
   }
 
-  if (warriors[curr_warrior].tasks != NULL)
+  if (mars->warriors[curr_warrior].task_pcs != NULL)
   {
-    cell_addr_t curr_pc = warriors[curr_warrior].tasks->pc;
+    cell_addr_t curr_pc = CURR_TASK_PC (&mars->warriors[curr_warrior]);
 
     Uint16 w = cell_size + 2;
     Uint16 h = cell_size + 2;
@@ -326,18 +331,21 @@ display_insn (unsigned int curr_warrior)
   SDL_FillRect (screen, &rect, bg_clr_num);
 
   /* For the warrior, show the instruction that is about to be executed. */
-  if (warriors[curr_warrior].tasks != NULL)
+  if (mars->warriors[curr_warrior].task_pcs != NULL)
   {
-    cell_addr_t curr_pc = warriors[curr_warrior].tasks->pc;
+    cell_addr_t curr_pc = CURR_TASK_PC (&mars->warriors[curr_warrior]);
 
     int max_chars = (scr_width / 2 - 2 * gutter_size) / font_width;
 
     Uint16 x = gutter_size + curr_warrior * (scr_width / 2 - 2 * gutter_size);
     Uint16 y = core_rect.y - (6 * gutter_size + font_height);
 
+    cell_t curr_cell;
+    read_cell (mars, curr_pc, &curr_cell);
+
     char tmp_buf[TMP_BUF_SIZE];
     snprintf (tmp_buf, TMP_BUF_SIZE - 1, "@%04u:   ", curr_pc);
-    dump_insn (tmp_buf + 9, TMP_BUF_SIZE - 10, &core[curr_pc]);
+    dump_insn (tmp_buf + 9, TMP_BUF_SIZE - 10, &curr_cell);
     tmp_buf[TMP_BUF_SIZE - 1] = '\0';
 
     sdltxt_write (tmp_buf, max_chars, screen, x, y);
@@ -352,12 +360,13 @@ display_scores (void)
   int max_chars = (scr_width / 2 - 2 * gutter_size) / font_width;
 
   char tmp_buf[TMP_BUF_SIZE];
-  for (int i = 0; i < num_warriors; i++)
+  for (int i = 0; i < mars->num_warriors; i++)
   {
     Uint16 x = gutter_size + i * (scr_width / 2 - 2 * gutter_size);
     Uint16 y = core_rect.y - 7 * gutter_size - 2 * font_height;
 
-    snprintf (tmp_buf, TMP_BUF_SIZE - 1, "Score:   %u", warriors[i].score);
+    snprintf (tmp_buf, TMP_BUF_SIZE - 1, "Score:   %u",
+              mars->warriors[i].score);
     tmp_buf[TMP_BUF_SIZE - 1] = '\0';
     sdltxt_write (tmp_buf, max_chars, screen, x, y);
   }
@@ -371,7 +380,7 @@ draw_timer (unsigned int execed_insns)
 {
   Uint16 total_w = core_rect.w + 2;
   timer_rect.w
-    = (execed_insns * (uint32_t )total_w) / max_cycles;
+    = (execed_insns * (uint32_t )total_w) / mars->max_cycles;
   timer_rect.x = core_rect.x - 1 + core_rect.w + 2 - timer_rect.w;
   SDL_FillRect (screen, &timer_rect, bg_clr_num);
 }
@@ -429,9 +438,9 @@ sdlui_process_event (SDL_Event *event, user_wish_t *cmd,
       {
         inspecting = false;
         write_status (paused_stat_msg);
-        if (warriors[curr_warrior].tasks != NULL)
+        if (mars->warriors[curr_warrior].task_pcs != NULL)
         {
-          warriors[curr_warrior].tasks->pc = inspect_orig_pc;
+          CURR_TASK_PC (&mars->warriors[curr_warrior]) = inspect_orig_pc;
         }
         display_insn (curr_warrior);
         draw_pc_ind (curr_warrior);
@@ -454,12 +463,12 @@ sdlui_process_event (SDL_Event *event, user_wish_t *cmd,
     case SDLK_DOWN:
     case SDLK_RIGHT:
     case SDLK_LEFT:
-      if (paused == true && warriors[curr_warrior].tasks != NULL)
+      if (paused == true && mars->warriors[curr_warrior].task_pcs != NULL)
       {
         inspecting = true;
         write_status (inspecting_stat_msg);
 
-        cell_addr_t curr_pc = warriors[curr_warrior].tasks->pc;
+        cell_addr_t curr_pc = CURR_TASK_PC (&mars->warriors[curr_warrior]);
 
         if (event->key.keysym.sym == SDLK_UP)
         {
@@ -478,7 +487,7 @@ sdlui_process_event (SDL_Event *event, user_wish_t *cmd,
           curr_pc = (curr_pc + core_size - 1) % core_size;
         }
         
-        warriors[curr_warrior].tasks->pc = curr_pc;
+        CURR_TASK_PC (&mars->warriors[curr_warrior]) = curr_pc;
         display_insn (curr_warrior);
         draw_pc_ind (curr_warrior);
         SDL_UpdateRect (screen, 0, 0, scr_width, scr_height);
@@ -528,7 +537,7 @@ sdlui_update_battle (unsigned int curr_warrior, cell_addr_t mod_cell,
 
   if (paused == true || queued_updates >= MAX_QUEUED_UPDATES)
   {
-    for (unsigned int i = 0U; i < num_warriors; i++)
+    for (unsigned int i = 0U; i < mars->num_warriors; i++)
     {
       display_insn (i);
     }
@@ -559,9 +568,9 @@ sdlui_update_battle (unsigned int curr_warrior, cell_addr_t mod_cell,
   }
 
   inspecting = false;
-  if (warriors[curr_warrior].tasks != NULL)
+  if (mars->warriors[curr_warrior].task_pcs != NULL)
   {
-    inspect_orig_pc = warriors[curr_warrior].tasks->pc;
+    inspect_orig_pc = CURR_TASK_PC (&mars->warriors[curr_warrior]);
   }
 
   /* Process user input, if any. */
@@ -590,12 +599,15 @@ sdlui_update_battle (unsigned int curr_warrior, cell_addr_t mod_cell,
 }
 
 
-/* Initialises the user interface. FULL_SCREEN indicates if the display
-   should be shown using the full screen space or in a windowed display.
-   Returns 0 on success, a non-zero value on failure. */
+/* Initialises the user interface for showing the battles in the simulator
+   M. FULL_SCREEN indicates if the display should be shown using the full
+   screen space or in a windowed display. Returns 0 on success, a non-zero
+   value on failure. */
 int
-sdlui_init (bool full_screen)
+sdlui_init (bool full_screen, mars_t *m)
 {
+  mars = m;
+
   // Initialise SDL.
   if (SDL_Init (SDL_INIT_VIDEO | SDL_INIT_TIMER) == -1)
   {
@@ -633,14 +645,14 @@ sdlui_init (bool full_screen)
   scr_bypp = screen->format->BytesPerPixel;
 
   char tmp_buf[TMP_BUF_SIZE];
-  if (num_warriors == 2)
+  if (mars->num_warriors == 2)
   {
-    snprintf (tmp_buf, TMP_BUF_SIZE - 1, "ZINC: %s v/s %s", warriors[0].name,
-             warriors[1].name);
+    snprintf (tmp_buf, TMP_BUF_SIZE - 1, "ZINC: %s v/s %s",
+              mars->warriors[0].name, mars->warriors[1].name);
   }
   else
   {
-    snprintf (tmp_buf, TMP_BUF_SIZE - 1, "ZINC: %s", warriors[0].name);
+    snprintf (tmp_buf, TMP_BUF_SIZE - 1, "ZINC: %s", mars->warriors[0].name);
   }
   tmp_buf[TMP_BUF_SIZE - 1] = '\0';
   SDL_WM_SetCaption (tmp_buf, NULL);
@@ -769,19 +781,22 @@ sdlui_start_battle (void)
   /* Point out the information about the warriors. */
   int max_chars = (scr_width / 2 - 2 * gutter_size) / font_width;
 
-  for (int i = 0; i < num_warriors; i++)
+  for (int i = 0; i < mars->num_warriors; i++)
   {
     x = gutter_size + i * (scr_width / 2 - 2 * gutter_size);
     y = core_rect.y - 10 * gutter_size - 5 * font_height;
 
-    snprintf (tmp_buf, TMP_BUF_SIZE - 1, "Warrior: %s %s", warriors[i].name,
-             (warriors[i].version == NULL) ? "" : warriors[i].version);
+    snprintf (tmp_buf, TMP_BUF_SIZE - 1, "Warrior: %s %s",
+              mars->warriors[i].name,
+              (mars->warriors[i].version == NULL) ? ""
+              : mars->warriors[i].version);
     tmp_buf[TMP_BUF_SIZE - 1] = '\0';
     sdltxt_write (tmp_buf, max_chars, screen, x, y);
 
     y += gutter_size + font_height;
     snprintf (tmp_buf, TMP_BUF_SIZE - 1, "Author:  %s",
-             (warriors[i].author == NULL) ? "" : warriors[i].author);
+             (mars->warriors[i].author == NULL) ? ""
+             : mars->warriors[i].author);
     tmp_buf[TMP_BUF_SIZE - 1] = '\0';
     sdltxt_write (tmp_buf, max_chars, screen, x, y);
 
@@ -792,7 +807,7 @@ sdlui_start_battle (void)
     col_rect.y = y;
     col_rect.w = 10 * font_width;
     col_rect.h = font_height;
-    SDL_FillRect (screen, &col_rect, warrior_clr_nums[warriors[i].id]);
+    SDL_FillRect (screen, &col_rect, warrior_clr_nums[mars->warriors[i].id]);
   }
 
   display_scores ();
@@ -836,7 +851,7 @@ sdlui_finish_battle (battle_status_t status, unsigned int end_warrior)
   user_wish_t cmd = RELOAD_WARRIORS;
 
   display_scores ();
-  for (unsigned int i = 0U; i < num_warriors; i++)
+  for (unsigned int i = 0U; i < mars->num_warriors; i++)
   {
     display_insn (i);
   }
@@ -848,12 +863,12 @@ sdlui_finish_battle (battle_status_t status, unsigned int end_warrior)
   {
   case WARRIOR_1_KILLED:
     snprintf (tmp_buf, TMP_BUF_SIZE - 1, "\"%s\" was killed",
-              warriors[0].name);
+              mars->warriors[0].name);
     break;
 
   case WARRIOR_2_KILLED:
     snprintf (tmp_buf, TMP_BUF_SIZE - 1, "\"%s\" was killed",
-              warriors[1].name);
+              mars->warriors[1].name);
     break;
 
   case CYCLES_EXHAUSTED:
@@ -886,9 +901,9 @@ sdlui_finish_battle (battle_status_t status, unsigned int end_warrior)
 
   paused = true;
   inspecting = false;
-  if (warriors[end_warrior].tasks != NULL)
+  if (mars->warriors[end_warrior].task_pcs != NULL)
   {
-    inspect_orig_pc = warriors[end_warrior].tasks->pc;
+    inspect_orig_pc = CURR_TASK_PC (&mars->warriors[end_warrior]);
   }
 
   SDL_Event event;
@@ -10,7 +10,7 @@
 #ifndef SDLUI_H_INCLUDED
 #define SDLUI_H_INCLUDED
 
-extern int sdlui_init (bool full_screen);
+extern int sdlui_init (bool full_screen, mars_t *m);
 
 extern user_wish_t sdlui_start_battle (void);
 
@@ -0,0 +1,439 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The server mode. The server listens on a Unix domain socket for clients,
+  each of which sends jobs over its connection, one per line, just like the
+  jobs of a batch (see batch.c). The results of every job are sent back
+  over the same connection as a line of JSON as soon as the job is over.
+
+  Up to MAX_CLIENTS clients are served at once by a single loop that waits
+  for any of them to send something. The clients with a whole job waiting
+  take turns, a job at a time, and a job gets all the threads of the
+  server. A client that sends a line longer than a batch allows gets an
+  error for it, and a client that sends nothing for SERVE_IDLE_TIMEOUT
+  seconds, or does not take its results within that time, is disconnected.
+  The warriors assembled for the jobs and the cache of the results of
+  battles are kept for as long as the server runs, so a job only pays for
+  the battles that have not been fought before. The server stops when it
+  is interrupted or terminated, removing its socket.
+*/
+
+/* Sockets and signal handling are not part of C99. */
+#if defined (__unix__) || defined (__APPLE__)
+#define ZINC_SOCKETS
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ZINC_SOCKETS
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+#include "zinc.h"
+#include "batch.h"
+#include "serve.h"
+
+/* The number of clients that can wait to be accepted. */
+#define SERVE_BACKLOG 16
+
+/* The maximum number of clients served at once. */
+#define MAX_CLIENTS 64U
+
+/* The number of seconds after which a client that has sent nothing is
+   disconnected, and for which the server waits for a client to take its
+   results. */
+#define SERVE_IDLE_TIMEOUT 300
+
+#ifdef ZINC_SOCKETS
+/* A client of the server. */
+typedef struct client
+{
+  /* The connection to the client, or -1 if there is no client, and the
+     stream writing the results of its jobs to it. */
+  int conn;
+  FILE *out;
+
+  /* What the client has sent that has not yet been run, the number of
+     characters in it and flag that indicates whether the rest of a line
+     that was too long is still to be skipped. */
+  char line[MAX_BATCH_LINE_LEN + 1];
+  size_t len;
+  bool skipping;
+
+  /* The number of lines the client has sent so far. */
+  unsigned int line_num;
+
+  /* Flag that indicates whether the client has closed its end of the
+     connection. */
+  bool eof;
+
+  /* The time at which the client last sent something or got the results
+     of a job. */
+  time_t last_active;
+} client_t;
+
+/* Flag that indicates whether the server has been asked to stop. */
+static volatile sig_atomic_t stop_serving = 0;
+
+
+/* Asks the server to stop on receiving the signal SIG. */
+static void
+handle_stop (int sig)
+{
+  (void )sig;
+  stop_serving = 1;
+}
+
+
+/* Starts serving the client C connected on the socket CONN. If the client
+   cannot be served, CONN is closed instead. */
+static void
+open_client (client_t *c, int conn)
+{
+  int out_conn = dup (conn);
+  struct timeval timeout;
+
+  timeout.tv_sec = SERVE_IDLE_TIMEOUT;
+  timeout.tv_usec = 0;
+
+  c->conn = conn;
+  c->out = (out_conn >= 0) ? fdopen (out_conn, "w") : NULL;
+  c->len = 0U;
+  c->skipping = false;
+  c->line_num = 0U;
+  c->eof = false;
+  c->last_active = time (NULL);
+
+  /* A client that does not read its results must not hold up the
+     others. */
+  if (c->out == NULL
+      || setsockopt (conn, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                     sizeof (timeout)) != 0)
+  {
+    if (c->out != NULL)
+    {
+      fclose (c->out);
+    }
+    else if (out_conn >= 0)
+    {
+      close (out_conn);
+    }
+    close (conn);
+    c->conn = -1;
+  }
+}
+
+
+/* Stops serving the client C, closing its connection. */
+static void
+close_client (client_t *c)
+{
+  fclose (c->out);
+  close (c->conn);
+  c->conn = -1;
+  c->out = NULL;
+}
+
+
+/* Returns whether the client C has sent a whole job that is yet to be
+   run. */
+static bool
+has_job (const client_t *c)
+{
+  return (memchr (c->line, '\n', c->len) != NULL
+          || c->len == MAX_BATCH_LINE_LEN || (c->eof == true && c->len > 0U));
+}
+
+
+/* Reads what the client C has sent, which must not have a whole job yet,
+   skipping the rest of a line that was too long. */
+static void
+receive (client_t *c)
+{
+  ssize_t n = read (c->conn, c->line + c->len, MAX_BATCH_LINE_LEN - c->len);
+
+  if (n > 0)
+  {
+    c->len += (size_t )n;
+    c->last_active = time (NULL);
+  }
+  else if (n == 0 || errno != EINTR)
+  {
+    c->eof = true;
+  }
+
+  if (c->skipping == true)
+  {
+    char *end = (char *)memchr (c->line, '\n', c->len);
+
+    if (end != NULL)
+    {
+      c->len -= (size_t )(end + 1 - c->line);
+      memmove (c->line, end + 1, c->len);
+      c->skipping = false;
+    }
+    else
+    {
+      c->len = 0U;
+    }
+  }
+}
+
+
+/* Runs the next job sent by the client C, as described for serve_run().
+   There must be one. */
+static void
+run_client_job (client_t *c, unsigned int num_rounds,
+                unsigned int num_threads, uint64_t seed, unsigned int stride,
+                bool spread)
+{
+  char line[MAX_BATCH_LINE_LEN + 1];
+  char *end = (char *)memchr (c->line, '\n', c->len);
+  size_t len = (end != NULL) ? (size_t )(end + 1 - c->line) : c->len;
+  bool too_long = (end == NULL && c->eof == false);
+
+  memcpy (line, c->line, len);
+  line[len] = '\0';
+  c->len -= len;
+  memmove (c->line, c->line + len, c->len);
+  c->skipping = too_long;
+  c->line_num++;
+
+  /* A client that sends bad jobs or goes away only ends its own
+     connection. */
+  batch_run_job (line, too_long, c->line_num, c->out, num_rounds,
+                 num_threads, seed, stride, spread);
+  c->last_active = time (NULL);
+}
+#endif
+
+
+/* Listens for clients on the Unix domain socket at PATH, replacing any
+   socket already there, and runs the jobs sent by every client, writing
+   their results back to the client. A job plays NUM_ROUNDS battles with
+   the seed SEED, placing the warriors by a sweep if STRIDE is not 0 and
+   spreading the placements evenly if SPREAD is true, unless it says
+   otherwise, and runs up to NUM_THREADS battles at once. The jobs of the
+   clients are run in turn, one job of every client that has sent one at a
+   time. Returns 0 once the server has been asked to stop and 1 on
+   failure. */
+int
+serve_run (const char *path, unsigned int num_rounds,
+           unsigned int num_threads, uint64_t seed, unsigned int stride,
+           bool spread)
+{
+  int error = 0;
+
+#ifdef ZINC_SOCKETS
+  struct sockaddr_un addr;
+  struct sigaction action;
+  struct stat st;
+  int sock = -1;
+  client_t *clients = (client_t *)malloc (MAX_CLIENTS * sizeof (client_t));
+  struct pollfd fds[MAX_CLIENTS + 1U];
+
+  if (clients == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for clients.\n\n");
+    error = 1;
+  }
+  for (unsigned int i = 0U; clients != NULL && i < MAX_CLIENTS; i++)
+  {
+    clients[i].conn = -1;
+  }
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  if (error != 0)
+  {
+    /* Nothing to serve with. */
+  }
+  else if (strlen (path) >= sizeof (addr.sun_path))
+  {
+    fprintf (stderr, "ERROR: The path \"%s\" is too long for a socket.\n\n",
+             path);
+    error = 1;
+  }
+  else
+  {
+    strcpy (addr.sun_path, path);
+    if (lstat (path, &st) == 0 && S_ISSOCK (st.st_mode))
+    {
+      unlink (path);
+    }
+
+    sock = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0
+        || bind (sock, (struct sockaddr *)&addr, sizeof (addr)) != 0)
+    {
+      fprintf (stderr, "ERROR: Unable to create a socket at \"%s\".\n\n",
+               path);
+      error = 1;
+    }
+    else if (listen (sock, SERVE_BACKLOG) != 0)
+    {
+      fprintf (stderr, "ERROR: Unable to listen on \"%s\".\n\n", path);
+      unlink (path);
+      error = 1;
+    }
+  }
+
+  if (error == 0)
+  {
+    /* Without SA_RESTART, a signal to stop also ends the wait for the next
+       client or job. */
+    memset (&action, 0, sizeof (action));
+    sigemptyset (&action.sa_mask);
+    action.sa_handler = handle_stop;
+    sigaction (SIGINT, &action, NULL);
+    sigaction (SIGTERM, &action, NULL);
+
+    /* Writing to a client that has gone away must fail instead of killing
+       the server. */
+    action.sa_handler = SIG_IGN;
+    sigaction (SIGPIPE, &action, NULL);
+
+    printf ("Serving on \"%s\".\n", path);
+    fflush (stdout);
+  }
+
+  while (error == 0 && stop_serving == 0)
+  {
+    unsigned int num_clients = 0U;
+    bool pending = false;
+    time_t now;
+
+    /* Only wait for clients that have no whole job yet, and only for new
+       clients if there is room for them. Without waiting at all if a job
+       is ready to run, the clients are looked at once a second to
+       disconnect the idle ones. */
+    for (unsigned int i = 0U; i < MAX_CLIENTS; i++)
+    {
+      fds[i + 1U].fd = -1;
+      fds[i + 1U].events = POLLIN;
+      fds[i + 1U].revents = 0;
+      if (clients[i].conn >= 0)
+      {
+        num_clients++;
+        if (has_job (&clients[i]) == true)
+        {
+          pending = true;
+        }
+        else if (clients[i].eof == false)
+        {
+          fds[i + 1U].fd = clients[i].conn;
+        }
+      }
+    }
+    fds[0].fd = (num_clients < MAX_CLIENTS) ? sock : -1;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+
+    if (poll (fds, MAX_CLIENTS + 1U, (pending == true) ? 0 : 1000) < 0
+        && errno != EINTR)
+    {
+      fprintf (stderr, "ERROR: Unable to wait for clients on \"%s\".\n\n",
+               path);
+      unlink (path);
+      error = 1;
+    }
+
+    if (error == 0 && (fds[0].revents & POLLIN) != 0)
+    {
+      int conn = accept (sock, NULL, NULL);
+      unsigned int k = 0U;
+
+      while (conn >= 0 && clients[k].conn >= 0)
+      {
+        k++;
+      }
+      if (conn >= 0)
+      {
+        open_client (&clients[k], conn);
+      }
+      else if (errno != EINTR && errno != ECONNABORTED)
+      {
+        fprintf (stderr, "ERROR: Unable to accept clients on \"%s\".\n\n",
+                 path);
+        unlink (path);
+        error = 1;
+      }
+    }
+
+    for (unsigned int i = 0U; error == 0 && i < MAX_CLIENTS; i++)
+    {
+      if (fds[i + 1U].fd >= 0 && fds[i + 1U].revents != 0)
+      {
+        receive (&clients[i]);
+      }
+    }
+
+    now = time (NULL);
+    for (unsigned int i = 0U; error == 0 && i < MAX_CLIENTS; i++)
+    {
+      client_t *c = &clients[i];
+
+      if (c->conn >= 0 && has_job (c) == true)
+      {
+        run_client_job (c, num_rounds, num_threads, seed, stride, spread);
+        if (ferror (c->out))
+        {
+          close_client (c);
+        }
+      }
+      else if (c->conn >= 0
+               && (c->eof == true
+                   || difftime (now, c->last_active) >= SERVE_IDLE_TIMEOUT))
+      {
+        close_client (c);
+      }
+    }
+  }
+
+  for (unsigned int i = 0U; clients != NULL && i < MAX_CLIENTS; i++)
+  {
+    if (clients[i].conn >= 0)
+    {
+      close_client (&clients[i]);
+    }
+  }
+  free (clients);
+
+  if (error == 0)
+  {
+    unlink (path);
+  }
+  if (sock >= 0)
+  {
+    close (sock);
+  }
+#else
+  (void )path;
+  (void )num_rounds;
+  (void )num_threads;
+  (void )seed;
+  (void )stride;
+  (void )spread;
+  fprintf (stderr, "ERROR: This build of ZINC cannot serve on a "
+           "socket.\n\n");
+  error = 1;
+#endif
+
+  return error;
+}
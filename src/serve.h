@@ -0,0 +1,18 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the server mode.
+*/
+
+#ifndef SERVE_H_INCLUDED
+#define SERVE_H_INCLUDED
+
+extern int
+serve_run (const char *path, unsigned int num_rounds,
+           unsigned int num_threads, uint64_t seed, unsigned int stride,
+           bool spread);
+
+#endif /* SERVE_H_INCLUDED */
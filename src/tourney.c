@@ -0,0 +1,1279 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  Series of battles run without the graphical interface: a match between
+  the warriors given on the command line and a round-robin or a
+  Swiss-system tournament between any number of warriors. The battles of
+  a series are run at once on a pool of threads (see pool.c), each with a
+  simulator of its own. Every battle is seeded on its own and its outcome
+  is recorded separately, so the results of a series are the same for any
+  number of threads.
+
+  Instead of placing the warriors at random, a series can also sweep
+  through the offsets of the second warrior from the first allowed by the
+  minimum separation between programmes, or every so many of them, with
+  either warrior moving first. The results of a sweep are exact and do not
+  depend on any seed.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+
+#include "zinc.h"
+#include "mars.h"
+#include "exec.h"
+#include "pool.h"
+#include "cache.h"
+#include "tourney.h"
+#include "coord.h"
+#include "checkpoint.h"
+
+/* The advantage in the probability of winning a battle that is not a tie
+   that the sequential test for stopping a match early looks for, and
+   below which two warriors count as evenly matched. */
+#define SPRT_DELTA 0.1
+
+/* The number of battles per simulator played at once in a match that may
+   stop early. */
+#define SPRT_BATCH 4U
+
+/* The increment of the golden-ratio sequence of offsets of spread
+   placements, the fractional part of the golden ratio in 32-bit fixed
+   point. */
+#define SPREAD_GAMMA UINT32_C (0x9E3779B9)
+
+/* The number of independent sequences of offsets that the pairs of rounds
+   of spread placements take turns at, which gives the independent samples
+   that the variance of a mean score is estimated from. */
+#define SPREAD_SAMPLES 8U
+
+/* The number of battles played between checkpoints of a tournament, as
+   whole pairs of warriors, and the least number of seconds between the
+   writing of checkpoints. */
+#define CHECKPOINT_BATTLES 65536U
+#define CHECKPOINT_INTERVAL 60.0
+
+/* The simulators used to run the battles of a series. */
+typedef struct simulators
+{
+  /* The number of simulators. */
+  unsigned int num;
+
+  /* The number of simulators that have been set up, successfully or
+     not. */
+  unsigned int num_ready;
+
+  /* The simulators. */
+  mars_t *mars;
+
+  /* The simulators as contexts for pool_run(). */
+  void **ctxs;
+} simulators_t;
+
+/* The outcomes of a match. */
+typedef struct match
+{
+  /* The seed for placing the warriors. */
+  uint64_t seed;
+
+  /* Flag that indicates whether the placements are spread evenly, with
+     either warrior moving first in turn, instead of being random. */
+  bool spread;
+
+  /* The warriors taking part. */
+  const warrior_t *warriors;
+
+  /* The number of the round played as the first unit of work. */
+  unsigned int first_round;
+
+  /* The status at the end of every battle. */
+  battle_status_t *statuses;
+
+  /* The points scored by the warriors in every battle. */
+  uint32_t (*points)[MAX_WARRIORS];
+} match_t;
+
+/* The battles between a number of pairs of warriors. */
+typedef struct pairings
+{
+  /* The seed for placing the warriors. */
+  uint64_t seed;
+
+  /* The step between the offsets of the second warrior from the first in
+     a sweep, or 0 if the warriors are placed at random. */
+  unsigned int stride;
+
+  /* Flag that indicates whether the placements that are not those of a
+     sweep are spread evenly instead of being random. */
+  bool spread;
+
+  /* The warriors taking part. */
+  const warrior_t *entrants;
+
+  /* The pairs of warriors that meet. */
+  const pairing_t *pairings;
+
+  /* The number of rounds played by every pair. */
+  unsigned int num_rounds;
+
+  /* The scores of the two warriors in every battle. The battles are
+     numbered by pair and then by round. */
+  uint32_t (*scores)[2];
+} pairings_t;
+
+
+/* Returns the smallest offset of the second warrior from the first in a
+   sweep. The programmes must not overlap, whatever their lengths. */
+static unsigned int
+sweep_separation (void)
+{
+  return (min_prog_separation > max_prog_insns) ? min_prog_separation
+         : max_prog_insns;
+}
+
+
+/* Returns the number of battles between a pair of warriors in a sweep
+   through every STRIDE-th offset of the second warrior from the first,
+   each with either warrior moving first, or 0 if the core is too small
+   for any offset. */
+unsigned int
+tourney_sweep_rounds (unsigned int stride)
+{
+  unsigned int sep = sweep_separation ();
+
+  return (core_size < 2U * sep) ? 0U
+         : 2U * ((core_size - 2U * sep) / stride + 1U);
+}
+
+
+/* Sets up the simulators S for battles between the NUM_WARRIORS warriors
+   in WARRIORS, with one simulator per thread for up to NUM_THREADS threads
+   but no more than NUM_BATTLES. Returns 0 on success and 1 on failure, in
+   which case S must still be freed with free_simulators(). */
+static int
+alloc_simulators (simulators_t *s, const warrior_t *warriors,
+                  unsigned int num_warriors, unsigned int num_threads,
+                  unsigned int num_battles)
+{
+  int error = 0;
+
+  if (num_threads > 1U && pool_threaded == false)
+  {
+    fprintf (stderr,
+             "WARNING: Built without threads, running battles one by one.\n");
+    num_threads = 1U;
+  }
+  if (num_threads > num_battles)
+  {
+    num_threads = num_battles;
+  }
+
+  s->num = num_threads;
+  s->num_ready = 0U;
+  s->mars = (mars_t *)calloc (num_threads, sizeof (mars_t));
+  s->ctxs = (void **)malloc (num_threads * sizeof (void *));
+  if (s->mars == NULL || s->ctxs == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for simulators.\n\n");
+    error = 1;
+  }
+
+  /* A simulator that fails to be set up must still be freed. */
+  for (unsigned int i = 0U; error == 0 && i < num_threads; i++)
+  {
+    s->num_ready = i + 1U;
+    if (mars_init (&s->mars[i], warriors, num_warriors) != 0)
+    {
+      error = 1;
+    }
+    s->ctxs[i] = &s->mars[i];
+  }
+
+  return error;
+}
+
+
+/* Frees the simulators S. */
+static void
+free_simulators (simulators_t *s)
+{
+  for (unsigned int i = 0U; i < s->num_ready; i++)
+  {
+    mars_free (&s->mars[i]);
+  }
+  free (s->mars);
+  free (s->ctxs);
+}
+
+
+/* Fights the battle between the warriors loaded into the simulator M,
+   unless its result is in the cache of results, and stores its status at
+   the end in STATUS and the points scored by every warrior in POINTS.
+   Returns 0 on success and 1 on failure. */
+static int
+fight (mars_t *m, battle_status_t *status, uint32_t points[])
+{
+  int error = 0;
+
+  if (cache_recall (m, status, points) == true)
+  {
+    for (unsigned int i = 0U; i < m->num_warriors; i++)
+    {
+      m->warriors[i].score += points[i];
+    }
+  }
+  else
+  {
+    user_wish_t cmd = CONTINUE_BATTLE;
+    unsigned int end_warrior = 0U;
+
+    for (unsigned int i = 0U; i < m->num_warriors; i++)
+    {
+      points[i] = m->warriors[i].score;
+    }
+
+    error = exec_battle (m, status, &cmd, &end_warrior);
+    if (error == 0)
+    {
+      for (unsigned int i = 0U; i < m->num_warriors; i++)
+      {
+        points[i] = m->warriors[i].score - points[i];
+      }
+      cache_remember (m, *status, points);
+    }
+  }
+
+  return error;
+}
+
+
+/* Loads the warriors A and B into the simulator M, with A at the start of
+   the core and B at the offset OFFSET from it. A moves first if FIRST is 0
+   and second otherwise. */
+static void
+load_pair (mars_t *m, const warrior_t *a, const warrior_t *b,
+           unsigned int first, cell_addr_t offset)
+{
+  cell_addr_t start_addrs[2];
+
+  mars_enlist (m, first, a);
+  mars_enlist (m, 1U - first, b);
+  start_addrs[first] = 0U;
+  start_addrs[1U - first] = offset;
+  mars_load_at (m, start_addrs);
+}
+
+
+/* Returns the offset of the second warrior from the first in the round
+   ROUND of a series with spread placements given by SEED, using the random
+   number generator of the simulator M. The two rounds of every pair of
+   rounds share an offset. The pairs of rounds take turns at SPREAD_SAMPLES
+   sequences of offsets, each of which follows the golden-ratio sequence
+   from a random start, scaled to the offsets of a sweep, so that the
+   offsets of any number of rounds are spread almost evenly over all of
+   them. */
+static cell_addr_t
+spread_offset (mars_t *m, uint64_t seed, unsigned int round)
+{
+  unsigned int sep = sweep_separation ();
+  uint64_t num_offsets = core_size - 2U * sep + 1U;
+  unsigned int pair = round / 2U;
+  uint32_t x = 0U;
+
+  mars_seed (m, seed, pair % SPREAD_SAMPLES);
+  x = mars_rand (m) + (uint32_t )(pair / SPREAD_SAMPLES) * SPREAD_GAMMA;
+
+  return (cell_addr_t )(sep + (((uint64_t )x * num_offsets) >> 32));
+}
+
+
+/* Plays the round UNIT after the first round of the match described by
+   MATCH, given as a void pointer for pool_run(), in the simulator M.
+   Returns 0 on success and 1 on failure. */
+static int
+play_match_round (void *m, unsigned int unit, void *match)
+{
+  int error = 0;
+  mars_t *mars = (mars_t *)m;
+  match_t *mt = (match_t *)match;
+  unsigned int round = mt->first_round + unit;
+  unsigned int first = 0U;
+  battle_status_t status = ZINC_FUBARED;
+  uint32_t points[MAX_WARRIORS];
+
+  if (mt->spread == true)
+  {
+    first = round % 2U;
+    load_pair (mars, &mt->warriors[0], &mt->warriors[1], first,
+               spread_offset (mars, mt->seed, round));
+  }
+  else
+  {
+    mars_seed (mars, mt->seed, round);
+    mars_load (mars);
+  }
+
+  if (fight (mars, &status, points) != 0)
+  {
+    error = 1;
+  }
+
+  /* The outcome is recorded by warrior rather than by slot. */
+  if (first != 0U && status == WARRIOR_1_KILLED)
+  {
+    status = WARRIOR_2_KILLED;
+  }
+  else if (first != 0U && status == WARRIOR_2_KILLED)
+  {
+    status = WARRIOR_1_KILLED;
+  }
+  mt->statuses[round] = status;
+  for (unsigned int i = 0U; i < mars->num_warriors; i++)
+  {
+    mt->points[round][i] = points[(first == 0U) ? i : 1U - i];
+  }
+
+  return error;
+}
+
+
+/* Returns the logarithm of the bound that the likelihood ratio of a
+   sequential probability ratio test has to reach for the test to decide,
+   with the confidence CONFIDENCE (a fraction less than 1), that one of two
+   warriors wins more often than the other. For either warrior, the test
+   weighs the hypothesis that it wins a battle that is not a tie with the
+   probability 1/2 + SPRT_DELTA against the hypothesis that both warriors
+   win with the probability 1/2 (see sprt_log_ratio). The test never
+   decides for the latter, so that evenly matched warriors play all their
+   battles. Without such a decision, the chance that the ratio for a
+   warrior ever reaches the bound when the warriors are evenly matched is
+   at most the reciprocal of the bound, so with the bound
+   2 / (1 - CONFIDENCE), the test is wrong about either warrior with at
+   most the probability 1 - CONFIDENCE. */
+static double
+sprt_log_bound (double confidence)
+{
+  return log (2.0 / (1.0 - confidence));
+}
+
+
+/* Returns the logarithm of the likelihood ratio of the hypothesis that a
+   warrior wins a battle that is not a tie with the probability
+   1/2 + SPRT_DELTA to the hypothesis that it does so with the probability
+   1/2, given that it won WINS and lost LOSSES such battles. */
+static double
+sprt_log_ratio (unsigned int wins, unsigned int losses)
+{
+  return (wins * log (1.0 + 2.0 * SPRT_DELTA)
+          + losses * log (1.0 - 2.0 * SPRT_DELTA));
+}
+
+
+/* Prints out the mean score per battle of every one of the NUM_WARRIORS
+   warriors in WARRIORS over the NUM_BATTLES battles whose points are given
+   by POINTS, along with an estimate of the variance of each mean. For the
+   estimate, the battles are taken in groups of GROUP consecutive battles
+   that are dealt out in turn to up to MAX_SAMPLES independent samples,
+   leaving out the battles after the last complete deal. */
+static void
+print_mean_scores (const warrior_t *warriors, unsigned int num_warriors,
+                   uint32_t (*points)[MAX_WARRIORS], unsigned int num_battles,
+                   unsigned int group, unsigned int max_samples)
+{
+  unsigned int num_samples = num_battles / group;
+  unsigned int num_dealt = 0U;
+
+  if (num_samples > max_samples)
+  {
+    num_samples = max_samples;
+  }
+  num_dealt = (num_samples > 0U)
+              ? num_battles / (group * num_samples) * group * num_samples
+              : 0U;
+
+  printf ("\nMean Scores:\n");
+  for (unsigned int i = 0U; i < num_warriors; i++)
+  {
+    double mean = 0.0, dealt_mean = 0.0, variance = 0.0;
+
+    for (unsigned int j = 0U; j < num_battles; j++)
+    {
+      mean += points[j][i];
+    }
+    mean /= (num_battles > 0U) ? num_battles : 1U;
+
+    for (unsigned int j = 0U; j < num_dealt; j++)
+    {
+      dealt_mean += points[j][i];
+    }
+    dealt_mean /= (num_dealt > 0U) ? num_dealt : 1U;
+
+    for (unsigned int k = 0U; k < num_samples; k++)
+    {
+      double sample = 0.0;
+
+      for (unsigned int j = k * group; j < num_dealt;
+           j += group * num_samples)
+      {
+        for (unsigned int l = 0U; l < group; l++)
+        {
+          sample += points[j + l][i];
+        }
+      }
+      sample = sample / (num_dealt / num_samples) - dealt_mean;
+      variance += sample * sample;
+    }
+
+    printf ("    \"%s\" - %.4f", warriors[i].name, mean);
+    if (num_samples > 1U)
+    {
+      /* The variance of the mean of the samples, from their sample
+         variance. */
+      printf (" (variance %.6f)", variance / (num_samples - 1U)
+                                  / num_samples);
+    }
+    printf ("\n");
+  }
+}
+
+
+/* Plays NUM_ROUNDS battles between the NUM_WARRIORS warriors in WARRIORS,
+   running up to NUM_THREADS of them at once with the placements given by
+   SEED, and prints out the results. If SPREAD is true, there must be two
+   warriors, whose placements are then spread evenly, with either warrior
+   moving first in turn. If CONFIDENCE is not 0 and there are two
+   warriors, the match stops early once a sequential test decides with
+   that confidence which warrior is the stronger, and otherwise reports
+   that they are evenly matched after all the battles. Since the battles are
+   played in batches, the battles after the deciding one may already have
+   been played, but they are not counted, so the results are still the
+   same for any number of threads. Returns 0 on success and 1 on
+   failure. */
+int
+tourney_match (const warrior_t *warriors, unsigned int num_warriors,
+               unsigned int num_rounds, unsigned int num_threads,
+               uint64_t seed, bool spread, double confidence)
+{
+  int error = 0;
+  simulators_t sims;
+  match_t match;
+  unsigned int num_played = 0U;
+  double bound = 0.0;
+  unsigned int wins[2] = { 0U, 0U };
+  bool decided = false;
+
+  /* With spread placements, the two rounds of a pair, with the same
+     offset, are only fair together, so they are counted together. */
+  unsigned int round_group = (spread == true) ? 2U : 1U;
+
+  if (confidence > 0.0 && num_warriors == 2U)
+  {
+    bound = sprt_log_bound (confidence);
+  }
+
+  match.seed = seed;
+  match.spread = spread;
+  match.warriors = warriors;
+  match.first_round = 0U;
+  match.statuses
+    = (battle_status_t *)malloc (num_rounds * sizeof (battle_status_t));
+  match.points = (uint32_t (*)[MAX_WARRIORS])malloc (num_rounds
+                                                     * sizeof (*match.points));
+  if (match.statuses == NULL || match.points == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for battles.\n\n");
+    error = 1;
+  }
+
+  if (alloc_simulators (&sims, warriors, num_warriors, num_threads,
+                        num_rounds) != 0)
+  {
+    error = 1;
+  }
+  else if (spread == true && tourney_sweep_rounds (1U) == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small to spread the "
+             "placements.\n\n");
+    error = 1;
+  }
+
+  /* Without a test, all the battles are played in a single batch. */
+  while (error == 0 && num_played < num_rounds && decided == false)
+  {
+    unsigned int batch = num_rounds - num_played;
+
+    if (bound > 0.0 && batch > SPRT_BATCH * sims.num)
+    {
+      batch = SPRT_BATCH * sims.num;
+    }
+
+    match.first_round = num_played;
+    error = pool_run (sims.num, sims.ctxs, batch, play_match_round,
+                      &match);
+
+    for (unsigned int i = 0U; error == 0 && i < batch && decided == false;
+         i++)
+    {
+      uint32_t *points = match.points[num_played];
+
+      if (num_warriors == 2U && points[0] != points[1])
+      {
+        wins[(points[0] > points[1]) ? 0 : 1]++;
+      }
+      num_played++;
+      decided = (bound > 0.0 && num_played % round_group == 0U
+                 && (sprt_log_ratio (wins[0], wins[1]) >= bound
+                     || sprt_log_ratio (wins[1], wins[0]) >= bound));
+    }
+  }
+
+  if (error == 0)
+  {
+    printf ("Battle Results:\n");
+    for (unsigned int i = 0U; i < num_played; i++)
+    {
+      printf ("%4u. ", i);
+      switch (match.statuses[i])
+      {
+      case WARRIOR_1_KILLED:
+        printf ("\"%s\" was killed.\n", warriors[0].name);
+        break;
+
+      case WARRIOR_2_KILLED:
+        printf ("\"%s\" was killed.\n", warriors[1].name);
+        break;
+
+      case CYCLES_EXHAUSTED:
+        printf ("Timed out.\n");
+        break;
+
+      case USER_INTERRUPTED:
+        printf ("User interrupted.\n");
+        break;
+
+      case ZINC_FUBARED:
+      default:
+        fprintf (stderr, "** Internal Error ** \n");
+        break;
+      }
+    }
+
+    if (decided == true)
+    {
+      printf ("\nStopped after %u battles: \"%s\" is the stronger with "
+              "%g%% confidence.\n", num_played,
+              warriors[(wins[0] > wins[1]) ? 0 : 1].name,
+              confidence * 100.0);
+    }
+    else if (bound > 0.0)
+    {
+      printf ("\nNo significant difference between \"%s\" and \"%s\" "
+              "after %u battles at %g%% confidence.\n", warriors[0].name,
+              warriors[1].name, num_played, confidence * 100.0);
+    }
+
+    /* Print out the final scores. */
+    printf ("\nFinal Scores:\n");
+    for (unsigned int i = 0U; i < num_warriors; i++)
+    {
+      unsigned int score = 0U;
+
+      for (unsigned int j = 0U; j < num_played; j++)
+      {
+        score += match.points[j][i];
+      }
+      printf ("    \"%s\" - %u\n", warriors[i].name, score);
+    }
+
+    if (spread == true)
+    {
+      print_mean_scores (warriors, num_warriors, match.points, num_played,
+                         2U, SPREAD_SAMPLES);
+    }
+    else
+    {
+      print_mean_scores (warriors, num_warriors, match.points, num_played,
+                         1U, num_played);
+    }
+  }
+
+  free_simulators (&sims);
+  free (match.statuses);
+  free (match.points);
+
+  return error;
+}
+
+
+/* Plays the battle BATTLE of the battles described by PS, given as a void
+   pointer for pool_run(), in the simulator M. Returns 0 on success and 1
+   on failure. */
+static int
+play_pairing_round (void *m, unsigned int battle, void *ps)
+{
+  int error = 0;
+  mars_t *mars = (mars_t *)m;
+  pairings_t *t = (pairings_t *)ps;
+  const pairing_t *p = &t->pairings[battle / t->num_rounds];
+  unsigned int round = battle % t->num_rounds;
+  unsigned int first = 0U;
+  battle_status_t status = ZINC_FUBARED;
+  uint32_t points[MAX_WARRIORS];
+
+  if (t->stride == 0U && t->spread == true)
+  {
+    /* Every pair gets the same placements in a given round. */
+    first = round % 2U;
+    load_pair (mars, &t->entrants[p->first], &t->entrants[p->second], first,
+               spread_offset (mars, t->seed, round));
+  }
+  else if (t->stride == 0U)
+  {
+    mars_enlist (mars, 0U, &t->entrants[p->first]);
+    mars_enlist (mars, 1U, &t->entrants[p->second]);
+
+    /* Every pair gets the same placements in a given round. */
+    mars_seed (mars, t->seed, round);
+    mars_load (mars);
+  }
+  else
+  {
+    /* The rounds of a sweep take every offset in turn, first with the
+       first warrior moving first and then with the second. */
+    first = round % 2U;
+    load_pair (mars, &t->entrants[p->first], &t->entrants[p->second], first,
+               sweep_separation () + (round / 2U) * t->stride);
+  }
+
+  if (fight (mars, &status, points) != 0)
+  {
+    error = 1;
+  }
+  t->scores[battle][0] = points[first];
+  t->scores[battle][1] = points[1U - first];
+
+  return error;
+}
+
+
+/* Prints out the score of every one of the NUM_ENTRANTS warriors in
+   ENTRANTS against every other one, as given by MATRIX, and their total
+   scores. */
+static void
+print_score_matrix (const warrior_t *entrants, unsigned int num_entrants,
+                    const uint32_t *matrix)
+{
+  printf ("Warriors:\n");
+  for (unsigned int i = 0U; i < num_entrants; i++)
+  {
+    printf ("%4u. \"%s\"\n", i + 1U, entrants[i].name);
+  }
+
+  printf ("\nScore Matrix:\n      ");
+  for (unsigned int j = 0U; j < num_entrants; j++)
+  {
+    printf (" %6u", j + 1U);
+  }
+  printf ("   Total\n");
+
+  for (unsigned int i = 0U; i < num_entrants; i++)
+  {
+    uint32_t total = 0U;
+
+    printf ("%4u. ", i + 1U);
+    for (unsigned int j = 0U; j < num_entrants; j++)
+    {
+      if (i == j)
+      {
+        printf ("      -");
+      }
+      else
+      {
+        printf (" %6u", matrix[i * num_entrants + j]);
+        total += matrix[i * num_entrants + j];
+      }
+    }
+    printf (" %7u\n", total);
+  }
+}
+
+
+/* Plays NUM_ROUNDS battles for every one of the NUM_PAIRINGS pairs of
+   warriors in PAIRINGS, which refer to the warriors in ENTRANTS, running up
+   to NUM_THREADS of them at once with the placements given by SEED. If
+   STRIDE is not 0, the placements are instead those of a sweep through
+   every STRIDE-th offset, and NUM_ROUNDS must be the number given by
+   tourney_sweep_rounds(). Otherwise, if SPREAD is true, the placements are
+   spread evenly and either warrior moves first in turn. The scores of the
+   two warriors in every battle are stored in SCORES, by pair and then by
+   round. Every pair gets the same placements in a given round. Returns 0
+   on success and 1 on failure. */
+int
+tourney_play (const warrior_t *entrants, const pairing_t *pairings,
+              unsigned int num_pairings, unsigned int num_rounds,
+              unsigned int num_threads, uint64_t seed, unsigned int stride,
+              bool spread, uint32_t (*scores)[2])
+{
+  int error = 0;
+  uint64_t num_battles = (uint64_t )num_pairings * num_rounds;
+  simulators_t sims = { 0U, 0U, NULL, NULL };
+  pairings_t ps;
+
+  ps.seed = seed;
+  ps.stride = stride;
+  ps.spread = spread;
+  ps.entrants = entrants;
+  ps.pairings = pairings;
+  ps.num_rounds = num_rounds;
+  ps.scores = scores;
+
+  if (num_battles > UINT32_MAX)
+  {
+    fprintf (stderr, "ERROR: Too many battles.\n\n");
+    error = 1;
+  }
+  else if (num_battles > 0U)
+  {
+    error = alloc_simulators (&sims, entrants, 2U, num_threads,
+                              (unsigned int )num_battles);
+    if (error == 0)
+    {
+      error = pool_run (sims.num, sims.ctxs, (unsigned int )num_battles,
+                        play_pairing_round, &ps);
+    }
+    free_simulators (&sims);
+  }
+
+  return error;
+}
+
+
+/* Plays NUM_ROUNDS battles between every pair of the NUM_ENTRANTS warriors
+   in ENTRANTS, running up to NUM_THREADS of them at once with the
+   placements given by SEED, and prints out the score of every warrior
+   against every other one. If STRIDE is not 0, every pair instead plays a
+   sweep through every STRIDE-th offset. Otherwise, if SPREAD is true, the
+   placements are spread evenly and either warrior moves first in turn. If
+   NUM_WORKERS is not 0, the battles are played on that many worker
+   processes, each running up to NUM_THREADS of them at once. If
+   CHECKPOINT_FILE is not NULL, the pairs are played a few at a time and
+   the tournament is checkpointed to that file every so often, going on
+   from the checkpoint already in it, if any, with its seed unless
+   SEED_GIVEN is true. Returns 0 on success and 1 on failure. */
+int
+tourney_round_robin (const warrior_t *entrants, unsigned int num_entrants,
+                     unsigned int num_rounds, unsigned int num_threads,
+                     uint64_t seed, bool seed_given, unsigned int stride,
+                     bool spread, unsigned int num_workers,
+                     const char *checkpoint_file)
+{
+  int error = 0;
+  unsigned int num_pairings = num_entrants * (num_entrants - 1U) / 2U;
+  unsigned int num_pending = 0U;
+  unsigned int chunk = 0U;
+  uint64_t num_battles = 0U;
+
+  /* The worker processes only send back the total scores of every pair,
+     which are then kept as if they came from a single battle. */
+  unsigned int num_kept = 1U;
+
+  if (stride != 0U)
+  {
+    num_rounds = tourney_sweep_rounds (stride);
+  }
+  if (num_workers == 0U)
+  {
+    num_kept = num_rounds;
+  }
+  num_battles = (uint64_t )num_pairings * num_kept;
+  pairing_t *pairings = NULL;
+  unsigned int *pending = NULL;
+  pairing_t *chunk_pairings = NULL;
+  uint32_t (*scores)[2] = NULL;
+  uint32_t *matrix = NULL;
+  checkpoint_t ckpt;
+
+  ckpt.file = checkpoint_file;
+  ckpt.entrants = entrants;
+  ckpt.num_entrants = num_entrants;
+  ckpt.num_rounds = num_rounds;
+  ckpt.seed = seed;
+  ckpt.seed_given = seed_given;
+  ckpt.stride = stride;
+  ckpt.spread = spread;
+  ckpt.done = NULL;
+  ckpt.totals = NULL;
+
+  if (num_entrants < 2U)
+  {
+    fprintf (stderr, "ERROR: A tournament needs at least two warriors.\n\n");
+    error = 1;
+  }
+  else if (num_entrants > UINT16_MAX || num_battles > UINT32_MAX)
+  {
+    fprintf (stderr, "ERROR: Too many battles in the tournament.\n\n");
+    error = 1;
+  }
+  else if (num_rounds == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small for a sweep.\n\n");
+    error = 1;
+  }
+  else if (spread == true && tourney_sweep_rounds (1U) == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small to spread the "
+             "placements.\n\n");
+    error = 1;
+  }
+
+  /* Without a checkpoint, all the pairs are played at once. */
+  if (error == 0)
+  {
+    chunk = num_pairings;
+    if (checkpoint_file != NULL)
+    {
+      chunk = CHECKPOINT_BATTLES / num_rounds;
+      chunk = (chunk == 0U) ? 1U : (chunk < num_pairings) ? chunk
+                                                          : num_pairings;
+    }
+
+    pairings = (pairing_t *)malloc (num_pairings * sizeof (pairing_t));
+    pending = (unsigned int *)malloc (num_pairings * sizeof (unsigned int));
+    chunk_pairings = (pairing_t *)malloc (chunk * sizeof (pairing_t));
+    scores = (uint32_t (*)[2])malloc ((uint64_t )chunk * num_kept
+                                      * sizeof (uint32_t[2]));
+    matrix = (uint32_t *)calloc (num_entrants * num_entrants,
+                                 sizeof (uint32_t));
+    ckpt.done = (bool *)calloc (num_pairings, sizeof (bool));
+    ckpt.totals = (uint32_t (*)[2])calloc (num_pairings, sizeof (uint32_t[2]));
+    if (pairings == NULL || pending == NULL || chunk_pairings == NULL
+        || scores == NULL || matrix == NULL || ckpt.done == NULL
+        || ckpt.totals == NULL)
+    {
+      fprintf (stderr, "ERROR: Unable to allocate memory for battles.\n\n");
+      error = 1;
+    }
+  }
+
+  if (error == 0 && checkpoint_file != NULL)
+  {
+    error = checkpoint_read (&ckpt);
+  }
+
+  if (error == 0)
+  {
+    unsigned int k = 0U;
+
+    for (unsigned int i = 0U; i < num_entrants; i++)
+    {
+      for (unsigned int j = i + 1U; j < num_entrants; j++)
+      {
+        pairings[k].first = i;
+        pairings[k].second = j;
+        if (ckpt.done[k] == false)
+        {
+          pending[num_pending++] = k;
+        }
+        k++;
+      }
+    }
+  }
+
+  /* Every battle is seeded on its own from the seed and its round, so the
+     pairs can be played in any order and in any number of goes. */
+  time_t last_saved = time (NULL);
+
+  for (unsigned int start = 0U; error == 0 && start < num_pending;
+       start += chunk)
+  {
+    unsigned int n = (num_pending - start < chunk) ? num_pending - start
+                                                   : chunk;
+
+    for (unsigned int p = 0U; p < n; p++)
+    {
+      chunk_pairings[p] = pairings[pending[start + p]];
+    }
+
+    if (num_workers == 0U)
+    {
+      error = tourney_play (entrants, chunk_pairings, n, num_rounds,
+                            num_threads, ckpt.seed, stride, spread, scores);
+    }
+    else
+    {
+      error = coord_play (entrants, chunk_pairings, n, num_rounds,
+                          num_workers, num_threads, ckpt.seed, stride,
+                          spread, scores);
+    }
+
+    for (uint64_t b = 0U; error == 0 && b < (uint64_t )n * num_kept; b++)
+    {
+      unsigned int k = pending[start + b / num_kept];
+
+      ckpt.totals[k][0] += scores[b][0];
+      ckpt.totals[k][1] += scores[b][1];
+      ckpt.done[k] = true;
+    }
+
+    if (error == 0 && checkpoint_file != NULL
+        && (start + n == num_pending
+            || difftime (time (NULL), last_saved) >= CHECKPOINT_INTERVAL))
+    {
+      error = checkpoint_write (&ckpt);
+      last_saved = time (NULL);
+    }
+  }
+
+  if (error == 0)
+  {
+    for (unsigned int k = 0U; k < num_pairings; k++)
+    {
+      pairing_t *p = &pairings[k];
+
+      matrix[p->first * num_entrants + p->second] = ckpt.totals[k][0];
+      matrix[p->second * num_entrants + p->first] = ckpt.totals[k][1];
+    }
+
+    print_score_matrix (entrants, num_entrants, matrix);
+  }
+
+  free (pairings);
+  free (pending);
+  free (chunk_pairings);
+  free (scores);
+  free (matrix);
+  free (ckpt.done);
+  free (ckpt.totals);
+
+  return error;
+}
+
+
+/* Compares the ranking keys pointed to by A and B for qsort(). */
+static int
+compare_keys (const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+
+/* Plays a Swiss-system tournament of NUM_SWISS_ROUNDS rounds between the
+   NUM_ENTRANTS warriors in ENTRANTS and prints out the standings. In every
+   round, the warriors are ranked by their scores so far, with the earlier
+   of two warriors with the same score ranked higher, and every warrior in
+   turn is paired with the next highest-ranked one that it has not met yet,
+   or just the next one if it has met all of them. With an odd number of
+   warriors, the lowest-ranked warrior that has not had a bye sits out the
+   round and scores as if it had tied every battle. Every pair plays
+   NUM_ROUNDS battles with the placements given by SEED, STRIDE and SPREAD
+   as in tourney_round_robin(), on NUM_WORKERS worker processes if it is
+   not 0 and running up to NUM_THREADS battles at once. Returns 0 on
+   success and 1 on failure. */
+int
+tourney_swiss (const warrior_t *entrants, unsigned int num_entrants,
+               unsigned int num_rounds, unsigned int num_threads,
+               uint64_t seed, unsigned int stride, bool spread,
+               unsigned int num_workers, unsigned int num_swiss_rounds)
+{
+  int error = 0;
+  unsigned int num_pairs = num_entrants / 2U;
+  unsigned int num_kept = 1U;
+  uint64_t num_battles = 0U;
+  uint32_t bye_points = 0U;
+  uint64_t *keys = NULL;
+  unsigned int *ranks = NULL;
+  unsigned int *opponents = NULL;
+  unsigned int *num_met = NULL;
+  bool *paired = NULL;
+  bool *had_bye = NULL;
+  uint32_t *points = NULL;
+  pairing_t *pairings = NULL;
+  uint32_t (*scores)[2] = NULL;
+
+  if (stride != 0U)
+  {
+    num_rounds = tourney_sweep_rounds (stride);
+  }
+  if (num_workers == 0U)
+  {
+    num_kept = num_rounds;
+  }
+
+  /* A bye is worth a tie in every battle, as scored by update_scores() in
+     exec.c. */
+  bye_points = num_rounds * ((MAX_WARRIORS * MAX_WARRIORS - 1U)
+                             / MAX_WARRIORS);
+
+  if (num_entrants < 2U)
+  {
+    fprintf (stderr, "ERROR: A tournament needs at least two warriors.\n\n");
+    error = 1;
+  }
+  else if (num_entrants > UINT16_MAX
+           || (uint64_t )num_pairs * num_kept > UINT32_MAX
+           || (uint64_t )num_swiss_rounds * num_rounds
+              * (MAX_WARRIORS * MAX_WARRIORS - 1U) > UINT32_MAX)
+  {
+    fprintf (stderr, "ERROR: Too many battles in the tournament.\n\n");
+    error = 1;
+  }
+  else if (num_rounds == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small for a sweep.\n\n");
+    error = 1;
+  }
+  else if (spread == true && tourney_sweep_rounds (1U) == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small to spread the "
+             "placements.\n\n");
+    error = 1;
+  }
+
+  if (error == 0)
+  {
+    keys = (uint64_t *)malloc (num_entrants * sizeof (uint64_t));
+    ranks = (unsigned int *)malloc (num_entrants * sizeof (unsigned int));
+    opponents = (unsigned int *)malloc ((uint64_t )num_entrants
+                                        * num_swiss_rounds
+                                        * sizeof (unsigned int));
+    num_met = (unsigned int *)calloc (num_entrants, sizeof (unsigned int));
+    paired = (bool *)malloc (num_entrants * sizeof (bool));
+    had_bye = (bool *)calloc (num_entrants, sizeof (bool));
+    points = (uint32_t *)calloc (num_entrants, sizeof (uint32_t));
+    pairings = (pairing_t *)malloc (num_pairs * sizeof (pairing_t));
+    scores = (uint32_t (*)[2])malloc ((uint64_t )num_pairs * num_kept
+                                      * sizeof (uint32_t[2]));
+    if (keys == NULL || ranks == NULL || opponents == NULL
+        || num_met == NULL || paired == NULL || had_bye == NULL
+        || points == NULL || pairings == NULL || scores == NULL)
+    {
+      fprintf (stderr, "ERROR: Unable to allocate memory for battles.\n\n");
+      error = 1;
+    }
+  }
+
+  for (unsigned int s = 0U; error == 0 && s <= num_swiss_rounds; s++)
+  {
+    unsigned int p = 0U;
+
+    /* The warriors are ranked by sorting keys that hold their scores
+       above their indices. */
+    for (unsigned int i = 0U; i < num_entrants; i++)
+    {
+      keys[i] = ((uint64_t )(UINT32_MAX - points[i]) << 32) | i;
+    }
+    qsort (keys, num_entrants, sizeof (uint64_t), compare_keys);
+    for (unsigned int r = 0U; r < num_entrants; r++)
+    {
+      ranks[r] = (unsigned int )(keys[r] & UINT32_MAX);
+      paired[ranks[r]] = false;
+    }
+
+    if (s == num_swiss_rounds)
+    {
+      /* The ranking after the last round gives the standings. */
+      break;
+    }
+
+    if (num_entrants % 2U != 0U)
+    {
+      unsigned int bye = ranks[num_entrants - 1U];
+
+      for (unsigned int r = num_entrants; r > 0U; r--)
+      {
+        if (had_bye[ranks[r - 1U]] == false)
+        {
+          bye = ranks[r - 1U];
+          break;
+        }
+      }
+      had_bye[bye] = true;
+      paired[bye] = true;
+      points[bye] += bye_points;
+    }
+
+    for (unsigned int r = 0U; r < num_entrants; r++)
+    {
+      unsigned int a = ranks[r];
+      unsigned int b = num_entrants;
+
+      for (unsigned int q = r + 1U; paired[a] == false && q < num_entrants;
+           q++)
+      {
+        unsigned int c = ranks[q];
+        bool met = false;
+
+        for (unsigned int m = 0U; paired[c] == false && m < num_met[a]; m++)
+        {
+          met = met || (opponents[(uint64_t )a * num_swiss_rounds + m] == c);
+        }
+
+        if (paired[c] == false && (b == num_entrants || met == false))
+        {
+          b = c;
+          if (met == false)
+          {
+            break;
+          }
+        }
+      }
+
+      if (b != num_entrants)
+      {
+        paired[a] = paired[b] = true;
+        opponents[(uint64_t )a * num_swiss_rounds + num_met[a]++] = b;
+        opponents[(uint64_t )b * num_swiss_rounds + num_met[b]++] = a;
+        pairings[p].first = a;
+        pairings[p].second = b;
+        p++;
+      }
+    }
+
+    if (num_workers == 0U)
+    {
+      error = tourney_play (entrants, pairings, num_pairs, num_rounds,
+                            num_threads, seed, stride, spread, scores);
+    }
+    else
+    {
+      error = coord_play (entrants, pairings, num_pairs, num_rounds,
+                          num_workers, num_threads, seed, stride, spread,
+                          scores);
+    }
+
+    for (uint64_t b = 0U; error == 0 && b < (uint64_t )num_pairs * num_kept;
+         b++)
+    {
+      pairing_t *pair = &pairings[b / num_kept];
+
+      points[pair->first] += scores[b][0];
+      points[pair->second] += scores[b][1];
+    }
+  }
+
+  if (error == 0)
+  {
+    uint64_t num_all = (uint64_t )num_entrants * (num_entrants - 1U) / 2U;
+
+    num_battles = (uint64_t )num_swiss_rounds * num_pairs * num_rounds;
+    printf ("Swiss Standings:\n");
+    for (unsigned int r = 0U; r < num_entrants; r++)
+    {
+      unsigned int i = ranks[r];
+
+      printf ("%4u. \"%s\" - %" PRIu32 "\n", r + 1U, entrants[i].name,
+              points[i]);
+    }
+    printf ("\nPlayed %" PRIu64 " battles in %u rounds instead of %" PRIu64
+            " in a round robin.\n", num_battles, num_swiss_rounds,
+            num_all * num_rounds);
+  }
+
+  free (keys);
+  free (ranks);
+  free (opponents);
+  free (num_met);
+  free (paired);
+  free (had_bye);
+  free (points);
+  free (pairings);
+  free (scores);
+
+  return error;
+}
+
+
+/* Plays a sweep through every STRIDE-th offset of the second of the two
+   warriors in WARRIORS from the first, with either warrior moving first,
+   running up to NUM_THREADS battles at once, and prints out the exact
+   scores of the warriors. Returns 0 on success and 1 on failure. */
+int
+tourney_sweep (const warrior_t *warriors, unsigned int num_threads,
+               unsigned int stride)
+{
+  int error = 0;
+  unsigned int num_rounds = tourney_sweep_rounds (stride);
+  pairing_t pairing = { 0U, 1U };
+  uint32_t (*scores)[2] = NULL;
+
+  if (num_rounds == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small for a sweep.\n\n");
+    error = 1;
+  }
+  else
+  {
+    scores = (uint32_t (*)[2])malloc (num_rounds * sizeof (uint32_t[2]));
+    if (scores == NULL)
+    {
+      fprintf (stderr, "ERROR: Unable to allocate memory for battles.\n\n");
+      error = 1;
+    }
+  }
+
+  if (error == 0)
+  {
+    error = tourney_play (warriors, &pairing, 1U, num_rounds, num_threads,
+                          0U, stride, false, scores);
+  }
+
+  if (error == 0)
+  {
+    unsigned int sep = sweep_separation ();
+
+    printf ("Placements:\n");
+    printf ("    Offsets from %u to %u in steps of %u (%u battles).\n",
+            sep, sep + (num_rounds / 2U - 1U) * stride, stride, num_rounds);
+
+    /* The rounds alternate between the first and the second warrior
+       moving first. */
+    printf ("\nFinal Scores:\n");
+    for (unsigned int i = 0U; i < 2U; i++)
+    {
+      uint32_t wins[2] = { 0U, 0U }, losses[2] = { 0U, 0U };
+      uint32_t ties[2] = { 0U, 0U }, points[2] = { 0U, 0U };
+
+      for (unsigned int r = 0U; r < num_rounds; r++)
+      {
+        unsigned int moved = ((r % 2U) == i) ? 0U : 1U;
+
+        if (scores[r][i] > scores[r][1U - i])
+        {
+          wins[moved]++;
+        }
+        else if (scores[r][i] < scores[r][1U - i])
+        {
+          losses[moved]++;
+        }
+        else
+        {
+          ties[moved]++;
+        }
+        points[moved] += scores[r][i];
+      }
+
+      printf ("    \"%s\" - %u\n", warriors[i].name, points[0] + points[1]);
+      for (unsigned int m = 0U; m < 2U; m++)
+      {
+        printf ("        %s %6u wins, %6u losses, %6u ties - %u\n",
+                (m == 0U) ? "Moving first: " : "Moving second:", wins[m],
+                losses[m], ties[m], points[m]);
+      }
+    }
+  }
+
+  free (scores);
+
+  return error;
+}
@@ -0,0 +1,52 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the series of battles run without the graphical
+  interface.
+*/
+
+#ifndef TOURNEY_H_INCLUDED
+#define TOURNEY_H_INCLUDED
+
+/* A pair of warriors that meet in a series of battles, with the first
+   warrior loaded first. */
+typedef struct pairing
+{
+  unsigned int first;
+  unsigned int second;
+} pairing_t;
+
+extern int
+tourney_play (const warrior_t *entrants, const pairing_t *pairings,
+              unsigned int num_pairings, unsigned int num_rounds,
+              unsigned int num_threads, uint64_t seed, unsigned int stride,
+              bool spread, uint32_t (*scores)[2]);
+
+extern int
+tourney_match (const warrior_t *warriors, unsigned int num_warriors,
+               unsigned int num_rounds, unsigned int num_threads,
+               uint64_t seed, bool spread, double confidence);
+
+extern int
+tourney_round_robin (const warrior_t *entrants, unsigned int num_entrants,
+                     unsigned int num_rounds, unsigned int num_threads,
+                     uint64_t seed, bool seed_given, unsigned int stride,
+                     bool spread, unsigned int num_workers,
+                     const char *checkpoint_file);
+
+extern int
+tourney_swiss (const warrior_t *entrants, unsigned int num_entrants,
+               unsigned int num_rounds, unsigned int num_threads,
+               uint64_t seed, unsigned int stride, bool spread,
+               unsigned int num_workers, unsigned int num_swiss_rounds);
+
+extern unsigned int tourney_sweep_rounds (unsigned int stride);
+
+extern int
+tourney_sweep (const warrior_t *warriors, unsigned int num_threads,
+               unsigned int stride);
+
+#endif /* TOURNEY_H_INCLUDED */
@@ -0,0 +1,338 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  Parametric sweeps of warriors. The first warrior is assembled once as a
+  template (see zasm.c) and the identifiers defined in it using definition
+  directives that are named as its parameters are then swept through
+  ranges of values. Every combination of values gives a variant of the
+  warrior, which is assembled from the template by evaluating the operands
+  of its instructions again without reading its file, and which then plays
+  the other warriors, a few variants at a time on the pool of threads.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "zinc.h"
+#include "zasm.h"
+#include "tourney.h"
+#include "tune.h"
+
+/* The number of variants whose battles are played at once. */
+#define TUNE_VARIANTS 64U
+
+
+/* Parses the parameter given by SPEC, of the form NAME=FROM:TO or
+   NAME=FROM:TO:STEP, into PARAM. Returns 0 on success and 1 on failure. */
+int
+tune_parse_param (const char *spec, tune_param_t *param)
+{
+  int error = 0;
+  size_t len = 0U;
+  char extra = '\0';
+
+  param->step = 1U;
+  while (isalnum ((unsigned char )spec[len]) || spec[len] == '_')
+  {
+    len++;
+  }
+
+  if (len == 0U || len > MAX_PARAM_NAME_LEN || spec[len] != '='
+      || !isalpha ((unsigned char )spec[0]))
+  {
+    error = 1;
+  }
+  else if (sscanf (spec + len + 1U, "%u:%u%c", &param->from, &param->to,
+                   &extra) != 2
+           && sscanf (spec + len + 1U, "%u:%u:%u%c", &param->from,
+                      &param->to, &param->step, &extra) != 3)
+  {
+    error = 1;
+  }
+
+  if (error == 0)
+  {
+    /* The assembler keeps identifiers in upper case. */
+    for (size_t i = 0U; i < len; i++)
+    {
+      param->name[i] = (char )toupper ((unsigned char )spec[i]);
+    }
+    param->name[len] = '\0';
+  }
+
+  if (error == 0 && (param->from > param->to || param->step == 0U))
+  {
+    error = 1;
+  }
+
+  if (error != 0)
+  {
+    fprintf (stderr, "ERROR: Bad parameter \"%s\" (use NAME=FROM:TO or "
+             "NAME=FROM:TO:STEP).\n\n", spec);
+  }
+
+  return error;
+}
+
+
+/* Sets VALUES to the values of the NUM_PARAMS parameters in PARAMS, which
+   take COUNTS values each, in the INDEX-th variant. The last parameter
+   changes the fastest. */
+static void
+variant_values (const tune_param_t *params, const unsigned int *counts,
+                unsigned int num_params, uint64_t index, cell_addr_t *values)
+{
+  for (unsigned int p = num_params; p > 0U; p--)
+  {
+    values[p - 1U] = (cell_addr_t )(params[p - 1U].from
+                                    + (index % counts[p - 1U])
+                                      * params[p - 1U].step);
+    index /= counts[p - 1U];
+  }
+}
+
+
+/* Sweeps the parameters in PARAMS, NUM_PARAMS of them, of the first of the
+   NUM_WARRIORS warriors in WARRIORS, playing NUM_ROUNDS battles between
+   every variant of it and every other warrior, running up to NUM_THREADS
+   of them at once with the placements given by SEED, STRIDE and SPREAD as
+   for tourney_round_robin(), and prints out the scores of every variant
+   against every other warrior and the best variant. Returns 0 on success
+   and 1 on failure. */
+int
+tune_run (const warrior_t *warriors, unsigned int num_warriors,
+          const tune_param_t *params, unsigned int num_params,
+          unsigned int num_rounds, unsigned int num_threads, uint64_t seed,
+          unsigned int stride, bool spread)
+{
+  int error = 0;
+  unsigned int num_opponents = num_warriors - 1U;
+  unsigned int counts[MAX_TEMPLATE_PARAMS];
+  const char *names[MAX_TEMPLATE_PARAMS];
+  cell_addr_t values[MAX_TEMPLATE_PARAMS];
+  cell_addr_t best_values[MAX_TEMPLATE_PARAMS];
+  uint64_t num_variants = 1U;
+  uint32_t best_total = 0U;
+  warrior_t base = warriors[0];
+  warrior_t *entrants = NULL;
+  pairing_t *pairings = NULL;
+  uint32_t (*scores)[2] = NULL;
+
+  if (stride != 0U)
+  {
+    num_rounds = tourney_sweep_rounds (stride);
+  }
+
+  for (unsigned int p = 0U; p < num_params; p++)
+  {
+    if (params[p].to >= core_size)
+    {
+      fprintf (stderr, "ERROR: The values of \"%s\" must be less than the "
+               "size of the core.\n\n", params[p].name);
+      error = 1;
+    }
+    else
+    {
+      names[p] = params[p].name;
+      counts[p] = (params[p].to - params[p].from) / params[p].step + 1U;
+      if (num_variants <= UINT32_MAX)
+      {
+        num_variants *= counts[p];
+      }
+      best_values[p] = (cell_addr_t )params[p].from;
+    }
+  }
+
+  if (error != 0)
+  {
+    /* The error has been reported already. */
+  }
+  else if (num_warriors < 2U)
+  {
+    fprintf (stderr, "ERROR: A sweep of parameters needs a warrior and at "
+             "least one opponent.\n\n");
+    error = 1;
+  }
+  else if (num_variants > UINT32_MAX
+           || (uint64_t )TUNE_VARIANTS * num_opponents * num_rounds
+              > UINT32_MAX)
+  {
+    fprintf (stderr, "ERROR: Too many battles in the sweep.\n\n");
+    error = 1;
+  }
+  else if (num_rounds == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small for a sweep.\n\n");
+    error = 1;
+  }
+  else if (spread == true && tourney_sweep_rounds (1U) == 0U)
+  {
+    fprintf (stderr, "ERROR: The core is too small to spread the "
+             "placements.\n\n");
+    error = 1;
+  }
+
+  if (error == 0)
+  {
+    entrants = (warrior_t *)malloc ((num_opponents + TUNE_VARIANTS)
+                                    * sizeof (warrior_t));
+    pairings = (pairing_t *)malloc (TUNE_VARIANTS * num_opponents
+                                    * sizeof (pairing_t));
+    scores = (uint32_t (*)[2])malloc ((uint64_t )TUNE_VARIANTS
+                                      * num_opponents * num_rounds
+                                      * sizeof (uint32_t[2]));
+    if (entrants == NULL || pairings == NULL || scores == NULL)
+    {
+      fprintf (stderr, "ERROR: Unable to allocate memory for battles.\n\n");
+      error = 1;
+    }
+  }
+
+  /* The template is assembled from a copy of the warrior, which gets
+     instructions and descriptions of its own. */
+  base.name = NULL;
+  base.version = NULL;
+  base.author = NULL;
+  base.insns = NULL;
+  if (error == 0)
+  {
+    error = assemble_template (&base);
+  }
+
+  /* The first variant is assembled once up front, so that a name that is
+     not that of a parameter is found before anything is printed out. */
+  if (error == 0)
+  {
+    warrior_t first = base;
+
+    variant_values (params, counts, num_params, 0U, values);
+    first.insns = NULL;
+    error = assemble_variant (names, values, num_params, &first);
+    free (first.insns);
+  }
+
+  if (error == 0)
+  {
+    memcpy (entrants, &warriors[1], num_opponents * sizeof (warrior_t));
+
+    printf ("Warrior:\n    \"%s\"\n\n", warriors[0].name);
+    printf ("Opponents:\n");
+    for (unsigned int o = 0U; o < num_opponents; o++)
+    {
+      printf ("%4u. \"%s\"\n", o + 1U, entrants[o].name);
+    }
+
+    printf ("\nVariants (%" PRIu64 "):\n", num_variants);
+    for (unsigned int p = 0U; p < num_params; p++)
+    {
+      printf (" %8s", names[p]);
+    }
+    for (unsigned int o = 0U; o < num_opponents; o++)
+    {
+      printf (" %6u", o + 1U);
+    }
+    printf ("   Total\n");
+  }
+
+  for (uint64_t v0 = 0U; error == 0 && v0 < num_variants;
+       v0 += TUNE_VARIANTS)
+  {
+    unsigned int n = (num_variants - v0 < TUNE_VARIANTS)
+                     ? (unsigned int )(num_variants - v0) : TUNE_VARIANTS;
+    unsigned int num_ready = 0U;
+
+    for (unsigned int c = 0U; error == 0 && c < n; c++)
+    {
+      warrior_t *variant = &entrants[num_opponents + c];
+
+      variant_values (params, counts, num_params, v0 + c, values);
+      *variant = warriors[0];
+      variant->insns = NULL;
+      error = assemble_variant (names, values, num_params, variant);
+      if (error == 0)
+      {
+        num_ready++;
+        for (unsigned int o = 0U; o < num_opponents; o++)
+        {
+          pairings[c * num_opponents + o].first = num_opponents + c;
+          pairings[c * num_opponents + o].second = o;
+        }
+      }
+      else
+      {
+        free (variant->insns);
+      }
+    }
+
+    if (error == 0)
+    {
+      error = tourney_play (entrants, pairings, n * num_opponents,
+                            num_rounds, num_threads, seed, stride, spread,
+                            scores);
+    }
+
+    for (unsigned int c = 0U; error == 0 && c < n; c++)
+    {
+      uint32_t total = 0U;
+
+      variant_values (params, counts, num_params, v0 + c, values);
+
+      for (unsigned int p = 0U; p < num_params; p++)
+      {
+        printf (" %8u", (unsigned int )values[p]);
+      }
+      for (unsigned int o = 0U; o < num_opponents; o++)
+      {
+        uint32_t score = 0U;
+
+        for (unsigned int r = 0U; r < num_rounds; r++)
+        {
+          score += scores[(c * num_opponents + o) * num_rounds + r][0];
+        }
+        printf (" %6u", score);
+        total += score;
+      }
+      printf (" %7u\n", total);
+
+      if (v0 + c == 0U || total > best_total)
+      {
+        best_total = total;
+        memcpy (best_values, values, num_params * sizeof (cell_addr_t));
+      }
+    }
+
+    for (unsigned int c = 0U; c < num_ready; c++)
+    {
+      free (entrants[num_opponents + c].insns);
+    }
+  }
+
+  if (error == 0)
+  {
+    printf ("\nBest Variant:\n   ");
+    for (unsigned int p = 0U; p < num_params; p++)
+    {
+      printf (" %s=%u", names[p], (unsigned int )best_values[p]);
+    }
+    printf (" with a total score of %" PRIu32 ".\n", best_total);
+  }
+
+  free_template ();
+  free (base.insns);
+  free (base.name);
+  free (base.version);
+  free (base.author);
+  free (entrants);
+  free (pairings);
+  free (scores);
+
+  return error;
+}
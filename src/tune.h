@@ -0,0 +1,34 @@
+/* Copyright (c) 2006 Ranjit Mathew. All rights reserved.
+ * Use of this source code is governed by the terms of the BSD licence
+ * that can be found in the LICENCE file.
+ */
+
+/*
+  The interface to the parametric sweeps of warriors.
+*/
+
+#ifndef TUNE_H_INCLUDED
+#define TUNE_H_INCLUDED
+
+/* The maximum number of characters in the name of a parameter. */
+#define MAX_PARAM_NAME_LEN 31U
+
+/* A parameter of a warrior, the value of an identifier defined using a
+   definition directive, swept from FROM to TO in steps of STEP. */
+typedef struct tune_param
+{
+  char name[MAX_PARAM_NAME_LEN + 1U];
+  unsigned int from;
+  unsigned int to;
+  unsigned int step;
+} tune_param_t;
+
+extern int tune_parse_param (const char *spec, tune_param_t *param);
+
+extern int
+tune_run (const warrior_t *warriors, unsigned int num_warriors,
+          const tune_param_t *params, unsigned int num_params,
+          unsigned int num_rounds, unsigned int num_threads, uint64_t seed,
+          unsigned int stride, bool spread);
+
+#endif /* TUNE_H_INCLUDED */
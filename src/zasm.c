@@ -1239,13 +1239,13 @@ do_first_pass (FILE *fp, warrior_t *warrior)
 }
 
 
-/* Implements the second pass of the assembler. The partially assembled
-   instructions from the first pass are fully assembled (forward references
-   resolved, operand expressions evaluated, etc.) and the warrior programme
-   created and ready to be loaded into the core. WARRIOR is a pointer to
-   the warrior programme being born. Returns 0 on success, 1 on failure. */
+/* Evaluates the operands of the partially assembled instructions from the
+   first pass, and the offset of the starting instruction, with the symbols
+   as they stand into a fresh array of instructions for WARRIOR. The
+   partially assembled instructions are left as they are, so that they can
+   be evaluated again. Returns 0 on success, 1 on failure. */
 static int
-do_second_pass (warrior_t *warrior)
+eval_insns (warrior_t *warrior)
 {
   int error = 0;
 
@@ -1267,47 +1267,45 @@ do_second_pass (warrior_t *warrior)
     if (start_pc != NULL)
     {
       warrior->init_pc = normalise (eval_expr (start_pc, 0U, &error));
-      free (start_pc);
-      start_pc = NULL;
     }
 
     warrior->num_insns = num_insns;
     warrior->insns = (cell_t *)malloc (num_insns * sizeof (cell_t));
+    if (warrior->insns == NULL)
+    {
+      fprintf (stderr, "%s: ERROR: Unable to allocate memory for the "
+               "programme.\n", curr_file);
+      error = 1;
+    }
 
     cell_addr_t i = 0U;
-    while (insns_head != NULL)
+    for (tmp_insn_t *t = insns_head; warrior->insns != NULL && t != NULL;
+         t = t->next)
     {
-      warrior->insns[i].op_code = insns_head->op_code;
-      warrior->insns[i].mode_a = insns_head->mode_a;
-      warrior->insns[i].mode_b = insns_head->mode_b;
-      warrior->insns[i].op_a
-        = normalise (eval_expr (insns_head->op_a_expr, i, &error));
-      warrior->insns[i].op_b
-        = normalise (eval_expr (insns_head->op_b_expr, i, &error));
-
-      free_expr (insns_head->op_a_expr);
-      free_expr (insns_head->op_b_expr);
-
-      tmp_insn_t *tmp_ptr = insns_head;
-      insns_head = insns_head->next;
-      free (tmp_ptr);
+      warrior->insns[i].op_code = t->op_code;
+      warrior->insns[i].mode_a = t->mode_a;
+      warrior->insns[i].mode_b = t->mode_b;
+      warrior->insns[i].op_a = normalise (eval_expr (t->op_a_expr, i, &error));
+      warrior->insns[i].op_b = normalise (eval_expr (t->op_b_expr, i, &error));
 
       i++;
     }
   }
 
-  /* Clear the symbol table of all definitions. */
-  clear_syms ();
-
   return error;
 }
 
 
 /* Assembles a warrior programme from the instructions given in the
-   corresponding input file. WARRIOR is a pointer to the warrior
-   programme being created. Returns 0 on success, 1 on failure. */
+   corresponding input file like assemble_warrior(), but keeps the
+   partially assembled instructions and the symbols around as a template
+   from which variants of the programme can be assembled with
+   assemble_variant() without reading the file again, till free_template()
+   is called. Only one template can be kept at a time and no other
+   programme can be assembled meanwhile. WARRIOR is a pointer to the
+   warrior programme being created. Returns 0 on success, 1 on failure. */
 int
-assemble_warrior (warrior_t *warrior)
+assemble_template (warrior_t *warrior)
 {
   int error = 0;
   FILE *fp = NULL;
@@ -1334,9 +1332,100 @@ assemble_warrior (warrior_t *warrior)
 
     if (error == 0)
     {
-      error = do_second_pass (warrior);
+      error = eval_insns (warrior);
+    }
+  }
+
+  return error;
+}
+
+
+/* Assembles a variant of the warrior programme kept as a template by
+   assemble_template() into VARIANT, which should be a copy of the warrior
+   given to it, with the identifiers defined using definition directives
+   named in NAMES taking the corresponding values in VALUES in place of
+   their definitions. There are NUM_PARAMS of them, no more than
+   MAX_TEMPLATE_PARAMS. The instructions of the variant are freshly
+   allocated. Returns 0 on success, 1 on failure. */
+int
+assemble_variant (const char *const names[], const cell_addr_t values[],
+                  unsigned int num_params, warrior_t *variant)
+{
+  int error = 0;
+  sym_val_t *params[MAX_TEMPLATE_PARAMS];
+  expr_t *defs[MAX_TEMPLATE_PARAMS];
+  expr_t nums[MAX_TEMPLATE_PARAMS];
+  unsigned int p = 0U;
+
+  /* The definition of every parameter is replaced by its value while the
+     instructions are evaluated, and then put back. */
+  for (p = 0U; p < num_params; p++)
+  {
+    params[p] = get_sym (names[p]);
+    if (params[p] == NULL || params[p]->type != SYM_EXPR)
+    {
+      fprintf (stderr, "%s: ERROR: \"%s\" is not defined by a definition "
+               "directive.\n", curr_file, names[p]);
+      error = 1;
+      break;
     }
+
+    nums[p].type = EXPR_NUMBER;
+    nums[p].u.num_val = values[p];
+    nums[p].src_line = params[p]->u.expr->src_line;
+    defs[p] = params[p]->u.expr;
+    params[p]->u.expr = &nums[p];
+  }
+
+  if (error == 0)
+  {
+    error = eval_insns (variant);
   }
 
+  while (p > 0U)
+  {
+    p--;
+    params[p]->u.expr = defs[p];
+  }
+
+  return error;
+}
+
+
+/* Frees the partially assembled instructions and the symbols kept by the
+   assembler, in particular those of a template kept by
+   assemble_template(). */
+void
+free_template (void)
+{
+  while (insns_head != NULL)
+  {
+    free_expr (insns_head->op_a_expr);
+    free_expr (insns_head->op_b_expr);
+
+    tmp_insn_t *tmp_ptr = insns_head;
+    insns_head = insns_head->next;
+    free (tmp_ptr);
+  }
+  insns_tail = NULL;
+
+  free (start_pc);
+  start_pc = NULL;
+
+  /* Clear the symbol table of all definitions. */
+  clear_syms ();
+}
+
+
+/* Assembles a warrior programme from the instructions given in the
+   corresponding input file. WARRIOR is a pointer to the warrior
+   programme being created. Returns 0 on success, 1 on failure. */
+int
+assemble_warrior (warrior_t *warrior)
+{
+  int error = assemble_template (warrior);
+
+  free_template ();
+
   return error;
 }
@@ -16,8 +16,19 @@ typedef unsigned int line_t;
 /* Represents a column number. */
 typedef unsigned int col_t;
 
+/* The maximum number of parameters of a template. */
+#define MAX_TEMPLATE_PARAMS 8U
+
 extern int assemble_warrior (warrior_t *warrior);
 
+extern int assemble_template (warrior_t *warrior);
+
+extern int
+assemble_variant (const char *const names[], const cell_addr_t values[],
+                  unsigned int num_params, warrior_t *variant);
+
+extern void free_template (void);
+
 extern void input_error (const char *msg, line_t where);
 
 #endif /* ZASM_H_INCLUDED */
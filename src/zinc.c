@@ -9,20 +9,33 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <dirent.h>
 
 /* This should not have been necessary in this module, but the main method
    might have to be renamed on some platforms (e.g. Win32) by SDL. */
 #include <SDL.h>
 
 #include "zinc.h"
+#include "mars.h"
 #include "zasm.h"
 #include "exec.h"
 #include "sdlui.h"
 #include "dump.h"
+#include "modarith.h"
+#include "core.h"
+#include "tourney.h"
+#include "hill.h"
+#include "cache.h"
+#include "batch.h"
+#include "serve.h"
+#include "coord.h"
+#include "tune.h"
+#include "evolve.h"
 
 /* The current version of ZINC. */
 const char *zinc_version = "0.1";
@@ -30,18 +43,19 @@ const char *zinc_version = "0.1";
 /* The size of the core. */
 unsigned int core_size = DEFAULT_CORE_SIZE;
 
-/* The core. */
-cell_t *core = NULL;
+/* The reciprocal of the size of the core used for fast remainders. */
+uint32_t core_size_recip = 0U;
 
 /* The minimum guaranteed number of cells separating two programmes when
    they are loaded into the core. */
 unsigned int min_prog_separation = DEFAULT_MIN_PROG_SEP;
 
-/* The number of warriors that have been loaded into the core. */
-unsigned int num_warriors = 0U;
+/* The number of warrior programmes given on the command line. */
+static unsigned int num_warriors = 0U;
 
-/* The warrior programmes. */
-warrior_t warriors[MAX_WARRIORS];
+/* The assembled warrior programmes. There can be more than MAX_WARRIORS of
+   them only in a tournament. */
+static warrior_t *warriors = NULL;
 
 /* The maximum number of cycles for which to run the simulator. */
 unsigned int max_cycles = DEFAULT_MAX_CYCLES;
@@ -64,9 +78,74 @@ static bool opt_full_screen = false;
    by the loader after assembly. */
 static bool opt_dump_progs = false;
 
+/* Flag that indicates whether to play a round-robin tournament between
+   the warriors. */
+static bool opt_tourney = false;
+
+/* The parameters of the first warrior to sweep through, if any. */
+static tune_param_t opt_params[MAX_TEMPLATE_PARAMS];
+static unsigned int opt_num_params = 0U;
+
+/* The number of generations to evolve the first warrior for, or 0 not to
+   evolve it, and the folder to write the survivors to, if any. */
+static unsigned int opt_num_generations = 0U;
+static const char *opt_out_dir = NULL;
+
+/* The file holding the hill to challenge with the warriors, if any, and
+   the number of warriors kept on a new hill. */
+static const char *opt_hill_file = NULL;
+static unsigned int opt_hill_size = DEFAULT_HILL_SIZE;
+
+/* The number of warriors at the top of a hill that a challenger has to be
+   able to make to go on playing, or 0 to always play all the incumbents. */
+static unsigned int opt_hill_top = 0U;
+
+/* The number of rounds of a Swiss-system tournament, or 0 to play a
+   round-robin tournament. */
+static unsigned int opt_swiss_rounds = 0U;
+
+/* The file holding the jobs to run in batch mode, or "-" for the standard
+   input, if any. */
+static const char *opt_batch_file = NULL;
+
+/* The Unix domain socket to serve jobs on, if any. */
+static const char *opt_socket = NULL;
+
+/* The file holding the checkpoint of a tournament, if any. */
+static const char *opt_checkpoint_file = NULL;
+
+/* The file holding the cache of the results of battles, if any. */
+static const char *opt_cache_file = NULL;
+
+/* The step between the offsets of one warrior from another in a sweep
+   through their placements, or 0 to place the warriors at random. */
+static unsigned int opt_sweep_stride = 0U;
+
+/* Flag that indicates whether to spread the placements of the warriors
+   evenly, with either warrior moving first in turn, instead of placing
+   them at random. */
+static bool opt_spread = false;
+
 /* The maximum number of battles to run in non-interactive mode. */
 static unsigned int max_ni_battles = 10;
 
+/* The confidence, as a fraction, with which a match between two warriors
+   may stop before all of its battles have been run, or 0 to always run
+   all of them. */
+static double opt_confidence = 0.0;
+
+/* The number of battles to run at once in non-interactive mode. */
+static unsigned int opt_num_threads = 1U;
+
+/* The number of worker processes to play a tournament on, or 0 to play it
+   in this process. */
+static unsigned int opt_num_workers = 0U;
+
+/* Flag that indicates whether a seed for placing the warriors has been
+   given, and the seed itself. */
+static bool opt_seed_given = false;
+static uint64_t opt_seed = 0U;
+
 
 /* Prints out the usage of the programme as well as a short copyright
    notice. PROG_NAME is what the programme should call itself. */
@@ -77,23 +156,199 @@ print_usage (const char *prog_name)
   printf ("Copyright (C) 2006 Ranjit Mathew.\n");
   printf ("\n");
   printf ("Usage: %s [options] file1 [file2]\n", prog_name);
+  printf ("       %s -t [options] file-or-folder...\n", prog_name);
+  printf ("       %s -k F [options] file-or-folder...\n", prog_name);
+  printf ("       %s -b F [options]\n", prog_name);
+  printf ("       %s -l F [options]\n", prog_name);
+  printf ("       %s -a P [options] file file-or-folder...\n", prog_name);
+  printf ("       %s -g N [options] file file-or-folder...\n", prog_name);
   printf ("Options:\n");
+  printf ("  -a P\tSweep the parameter P, of the form NAME=FROM:TO[:STEP],\n"
+          "\tof the first programme against the others (implies -c).\n");
+  printf ("  -b F\tRun the jobs in the file F, or the standard input if F\n"
+          "\tis \"-\", writing out their results as JSON (implies -c).\n");
   printf ("  -c \tUse command-line interface (no GUI).\n");
   printf ("  -d \tDump compiled programmes to stdout and exit.\n");
+  printf ("  -e P\tStop a match once the stronger programme is known with\n"
+          "\tP%% confidence (with -c, 50 < P < 100).\n");
   printf ("  -f \tRun full-screen.\n");
+  printf ("  -g N\tEvolve the first programme against the others for N\n"
+          "\tgenerations (implies -c).\n");
+  printf ("  -j N\tRun up to N battles at once (with -c).\n");
+  printf ("  -k F\tChallenge the hill in the file F with the programmes\n"
+          "\t(implies -c).\n");
+  printf ("  -K K\tStop playing a challenger once it cannot make the top\n"
+          "\tK programmes on the hill (with -k).\n");
+  printf ("  -l F\tServe jobs like those of -b to clients connecting to\n"
+          "\tthe Unix domain socket F (implies -c).\n");
+  printf ("  -m F\tKeep the results of battles in the file F and reuse\n"
+          "\tthem (with -c).\n");
+  printf ("  -n N\tRun N battles (with -c, default %u).\n", max_ni_battles);
+  printf ("  -o F\tWrite the evolved programmes to the folder F (with -g).\n");
+  printf ("  -p N\tPlay a tournament on N worker processes (with -t).\n");
+  printf ("  -q \tSpread the placements of the programmes evenly, with\n"
+          "\teither moving first in turn (with -c).\n");
+  printf ("  -r N\tUse N as the seed for placing the programmes.\n");
   printf ("  -s \tAllow only a single task per programme.\n");
+  printf ("  -t \tPlay a round-robin tournament between the programmes\n"
+          "\tin the given files and folders (implies -c).\n");
+  printf ("  -w F\tCheckpoint a tournament to the file F every so often\n"
+          "\tand resume it from there (with -t).\n");
+  printf ("  -x N\tPlay every N-th placement with either programme moving\n"
+          "\tfirst instead of random ones (implies -c).\n");
+  printf ("  -y N\tPlay a Swiss-system tournament of N rounds instead of a\n"
+          "\tround robin (with -t).\n");
+  printf ("  -z N\tKeep up to N programmes on a new hill (with -k, "
+          "default %u).\n", opt_hill_size);
   printf ("\n");
   printf ("Send bug reports to rmathew@gmail.com.\n");
 }
 
 
+/* Adds a warrior programme in the file FILE to the warriors to be
+   assembled. Returns 0 on success, 1 otherwise. */
+static int
+add_warrior (char *file)
+{
+  int error = 0;
+  warrior_t *more = (warrior_t *)realloc (warriors, (num_warriors + 1U)
+                                                     * sizeof (warrior_t));
+
+  if (more == NULL)
+  {
+    fprintf (stderr, "ERROR: Unable to allocate memory for warriors.\n\n");
+    error = 1;
+  }
+  else
+  {
+    warrior_t *w = &more[num_warriors];
+
+    w->id = UNKNOWN_WARRIOR + num_warriors + 1U;
+    w->alive = true;
+    w->file = file;
+    w->name = NULL;
+    w->version = NULL;
+    w->author = NULL;
+    w->num_insns = 0U;
+    w->insns = NULL;
+    w->init_pc = 0U;
+    w->load_addr = 0U;
+    w->num_tasks = 0U;
+    w->task_pcs = NULL;
+    w->curr_task = 0U;
+    w->score = 0U;
+
+    warriors = more;
+    num_warriors++;
+  }
+
+  return error;
+}
+
+
+/* Compares the file names pointed to by A and B for qsort(). */
+static int
+compare_names (const void *a, const void *b)
+{
+  return strcmp (*(char *const *)a, *(char *const *)b);
+}
+
+
+/* Adds the warrior programmes in the folder DIR_NAME, opened as DIR, that
+   is, the files in it with names ending in ".red" or ".zinc", in the order
+   of their names. Returns 0 on success, 1 otherwise. */
+static int
+add_warriors_in (DIR *dir, const char *dir_name)
+{
+  int error = 0;
+  char **files = NULL;
+  unsigned int num_files = 0U;
+  struct dirent *entry;
+
+  while (error == 0 && (entry = readdir (dir)) != NULL)
+  {
+    size_t len = strlen (entry->d_name);
+
+    if ((len > 4U && strcmp (entry->d_name + len - 4U, ".red") == 0)
+        || (len > 5U && strcmp (entry->d_name + len - 5U, ".zinc") == 0))
+    {
+      char **more
+        = (char **)realloc (files, (num_files + 1U) * sizeof (char *));
+      char *file = (char *)malloc (strlen (dir_name) + len + 2U);
+
+      if (more != NULL)
+      {
+        files = more;
+      }
+
+      if (more == NULL || file == NULL)
+      {
+        fprintf (stderr, "ERROR: Unable to allocate memory for warriors.\n\n");
+        free (file);
+        error = 1;
+      }
+      else
+      {
+        sprintf (file, "%s/%s", dir_name, entry->d_name);
+        files[num_files] = file;
+        num_files++;
+      }
+    }
+  }
+
+  qsort (files, num_files, sizeof (char *), compare_names);
+  for (unsigned int i = 0U; error == 0 && i < num_files; i++)
+  {
+    error = add_warrior (files[i]);
+  }
+  free (files);
+
+  return error;
+}
+
+
+/* Reads the value of the option in the argument at index *I in ARGV, which
+   is the argument following it, into VALUE and moves *I on to it. ARGC holds
+   the number of arguments. The value must be a number no less than MIN.
+   Returns 0 on success, 1 otherwise. */
+static int
+get_option_value (int argc, char *argv[], int *i, unsigned long long min,
+                  unsigned long long *value)
+{
+  int error = 0;
+  char option = argv[*i][1];
+
+  if (*i + 1 >= argc)
+  {
+    fprintf (stderr, "ERROR: Missing value for option \"%c\".\n\n", option);
+    error = 1;
+  }
+  else
+  {
+    char *end = NULL;
+
+    *i += 1;
+    *value = strtoull (argv[*i], &end, 10);
+    if (argv[*i][0] < '0' || argv[*i][0] > '9' || *end != '\0'
+        || *value < min)
+    {
+      fprintf (stderr, "ERROR: Invalid value \"%s\" for option \"%c\".\n\n",
+               argv[*i], option);
+      error = 1;
+    }
+  }
+
+  return error;
+}
+
+
 /* Processes command-line arguments. ARGC holds the number of arguments
    and ARGV points to the arguments. Returns 0 on success, 1 otherwise. */
 static int
 process_args (int argc, char *argv[])
 {
+  unsigned long long value = 0U;
   int i, error = 0;
-  int warrior_count = 0;
 
   for (i = 1; i < argc; i++)
   {
@@ -103,6 +358,47 @@ process_args (int argc, char *argv[])
     {
       switch (an_arg[1])
       {
+      case 'a':
+        if (i + 1 >= argc)
+        {
+          fprintf (stderr, "ERROR: Missing value for option \"a\".\n\n");
+          error = 1;
+        }
+        else if (opt_num_params >= MAX_TEMPLATE_PARAMS)
+        {
+          fprintf (stderr, "ERROR: Too many parameters (at most %u).\n\n",
+                   MAX_TEMPLATE_PARAMS);
+          error = 1;
+        }
+        else
+        {
+          i++;
+          if (tune_parse_param (argv[i], &opt_params[opt_num_params]) != 0)
+          {
+            error = 1;
+          }
+          else
+          {
+            opt_num_params++;
+            opt_no_gui = true;
+          }
+        }
+        break;
+
+      case 'b':
+        if (i + 1 >= argc)
+        {
+          fprintf (stderr, "ERROR: Missing value for option \"b\".\n\n");
+          error = 1;
+        }
+        else
+        {
+          i++;
+          opt_batch_file = argv[i];
+          opt_no_gui = true;
+        }
+        break;
+
       case 'c':
         opt_no_gui = true;
         break;
@@ -111,14 +407,214 @@ process_args (int argc, char *argv[])
         opt_dump_progs = true;
         break;
 
+      case 'e':
+        if (i + 1 >= argc)
+        {
+          fprintf (stderr, "ERROR: Missing value for option \"e\".\n\n");
+          error = 1;
+        }
+        else
+        {
+          char *end = NULL;
+
+          i++;
+          opt_confidence = strtod (argv[i], &end) / 100.0;
+          if (end == argv[i] || *end != '\0' || !(opt_confidence > 0.5)
+              || !(opt_confidence < 1.0))
+          {
+            fprintf (stderr, "ERROR: Invalid value \"%s\" for option "
+                     "\"e\".\n\n", argv[i]);
+            error = 1;
+          }
+        }
+        break;
+
       case 'f':
         opt_full_screen = true;
         break;
 
+      case 'g':
+        if (get_option_value (argc, argv, &i, 1U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          opt_num_generations = value;
+          opt_no_gui = true;
+        }
+        break;
+
+      case 'j':
+        if (get_option_value (argc, argv, &i, 1U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          opt_num_threads = (value < MAX_THREADS) ? value : MAX_THREADS;
+        }
+        break;
+
+      case 'k':
+        if (i + 1 >= argc)
+        {
+          fprintf (stderr, "ERROR: Missing value for option \"k\".\n\n");
+          error = 1;
+        }
+        else
+        {
+          i++;
+          opt_hill_file = argv[i];
+          opt_no_gui = true;
+        }
+        break;
+
+      case 'K':
+        if (get_option_value (argc, argv, &i, 1U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          opt_hill_top = value;
+        }
+        break;
+
+      case 'l':
+        if (i + 1 >= argc)
+        {
+          fprintf (stderr, "ERROR: Missing value for option \"l\".\n\n");
+          error = 1;
+        }
+        else
+        {
+          i++;
+          opt_socket = argv[i];
+          opt_no_gui = true;
+        }
+        break;
+
+      case 'm':
+        if (i + 1 >= argc)
+        {
+          fprintf (stderr, "ERROR: Missing value for option \"m\".\n\n");
+          error = 1;
+        }
+        else
+        {
+          i++;
+          opt_cache_file = argv[i];
+        }
+        break;
+
+      case 'n':
+        if (get_option_value (argc, argv, &i, 1U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          max_ni_battles = (value < UINT_MAX) ? value : UINT_MAX;
+        }
+        break;
+
+      case 'o':
+        if (i + 1 >= argc)
+        {
+          fprintf (stderr, "ERROR: Missing value for option \"o\".\n\n");
+          error = 1;
+        }
+        else
+        {
+          i++;
+          opt_out_dir = argv[i];
+        }
+        break;
+
+      case 'p':
+        if (get_option_value (argc, argv, &i, 1U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          opt_num_workers = (value < MAX_WORKERS) ? value : MAX_WORKERS;
+        }
+        break;
+
+      case 'q':
+        opt_spread = true;
+        break;
+
+      case 'r':
+        if (get_option_value (argc, argv, &i, 0U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          opt_seed = value;
+          opt_seed_given = true;
+        }
+        break;
+
       case 's':
         max_prog_tasks = 1U;
         break;
 
+      case 't':
+        opt_tourney = true;
+        opt_no_gui = true;
+        break;
+
+      case 'w':
+        if (i + 1 >= argc)
+        {
+          fprintf (stderr, "ERROR: Missing value for option \"w\".\n\n");
+          error = 1;
+        }
+        else
+        {
+          i++;
+          opt_checkpoint_file = argv[i];
+        }
+        break;
+
+      case 'x':
+        if (get_option_value (argc, argv, &i, 1U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          opt_sweep_stride = (value < core_size) ? value : core_size;
+          opt_no_gui = true;
+        }
+        break;
+
+      case 'y':
+        if (get_option_value (argc, argv, &i, 1U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          opt_swiss_rounds = value;
+        }
+        break;
+
+      case 'z':
+        if (get_option_value (argc, argv, &i, 1U, &value) != 0)
+        {
+          error = 1;
+        }
+        else
+        {
+          opt_hill_size = (value < UINT16_MAX) ? value : UINT16_MAX;
+        }
+        break;
+
       case '\0':
         fprintf (stderr, "ERROR: Missing option letter.\n\n");
         error = 1;
@@ -131,100 +627,169 @@ process_args (int argc, char *argv[])
         break;
       }
     }
-    else if (warrior_count < MAX_WARRIORS)
+    else
     {
-      warriors[warrior_count].file = an_arg;
-      warrior_count++;
+      DIR *dir = opendir (an_arg);
+
+      if (dir == NULL)
+      {
+        if (add_warrior (an_arg) != 0)
+        {
+          error = 1;
+        }
+      }
+      else
+      {
+        if (add_warriors_in (dir, an_arg) != 0)
+        {
+          error = 1;
+        }
+        closedir (dir);
+      }
     }
-    else
+  }
+
+  if (opt_batch_file != NULL || opt_socket != NULL)
+  {
+    if (num_warriors != 0U || opt_tourney == true || opt_hill_file != NULL
+        || (opt_batch_file != NULL && opt_socket != NULL))
     {
-      fprintf (stderr, "ERROR: Extra argument \"%s\".\n\n", an_arg);
+      fprintf (stderr, "ERROR: The warrior programmes of a batch are given "
+               "by its jobs.\n\n");
       error = 1;
     }
   }
-
-  if (warrior_count == 0)
+  else if (num_warriors == 0U)
   {
     fprintf (stderr, "ERROR: No warrior programme specified.\n\n");
     error = 1;
   }
+  else if (num_warriors > MAX_WARRIORS && opt_tourney == false
+           && opt_hill_file == NULL && opt_num_params == 0U
+           && opt_num_generations == 0U)
+  {
+    fprintf (stderr, "ERROR: Too many warrior programmes (use -t to play "
+             "a tournament).\n\n");
+    error = 1;
+  }
+  else if (num_warriors < 2U && opt_sweep_stride != 0U)
+  {
+    fprintf (stderr, "ERROR: A sweep needs two warrior programmes.\n\n");
+    error = 1;
+  }
 
-  num_warriors = warrior_count;
+  if (opt_sweep_stride != 0U && opt_hill_file != NULL)
+  {
+    fprintf (stderr, "ERROR: A hill cannot be played with a sweep.\n\n");
+    error = 1;
+  }
 
-  return error;
-}
+  if (opt_num_params > 0U
+      && (opt_tourney == true || opt_hill_file != NULL
+          || opt_batch_file != NULL || opt_socket != NULL
+          || opt_num_generations > 0U))
+  {
+    fprintf (stderr, "ERROR: Parameters can only be swept on their own.\n\n");
+    error = 1;
+  }
 
+  if (opt_num_generations > 0U
+      && (opt_tourney == true || opt_hill_file != NULL
+          || opt_batch_file != NULL || opt_socket != NULL))
+  {
+    fprintf (stderr, "ERROR: A warrior can only be evolved on its own.\n\n");
+    error = 1;
+  }
+  else if (opt_out_dir != NULL && opt_num_generations == 0U)
+  {
+    fprintf (stderr, "ERROR: Only evolved programmes can be written to a "
+             "folder.\n\n");
+    error = 1;
+  }
 
-/* Normalise the given integral value N according to the modulo arithmetic
-   rules. */
-cell_addr_t
-normalise (int32_t n)
-{
-  cell_addr_t ret_val = 0U;
+  if (opt_checkpoint_file != NULL
+      && (opt_tourney == false || opt_hill_file != NULL
+          || opt_swiss_rounds != 0U))
+  {
+    fprintf (stderr, "ERROR: Only a round-robin tournament can be "
+             "checkpointed.\n\n");
+    error = 1;
+  }
 
-  if (n == 0)
+  if (opt_swiss_rounds != 0U
+      && (opt_tourney == false || opt_hill_file != NULL))
   {
-    ret_val = 0U;
+    fprintf (stderr, "ERROR: Only a tournament can be played with the "
+             "Swiss system.\n\n");
+    error = 1;
   }
-  else if (n < 0)
+
+  if (opt_hill_top != 0U && opt_hill_file == NULL)
   {
-    while (n < 0)
-    {
-      n += core_size;
-    }
+    fprintf (stderr, "ERROR: Only the challengers of a hill can be "
+             "stopped.\n\n");
+    error = 1;
+  }
 
-    ret_val = n;
+  if (opt_spread == true && opt_hill_file != NULL)
+  {
+    fprintf (stderr, "ERROR: A hill cannot be played with spread "
+             "placements.\n\n");
+    error = 1;
   }
-  else
+  else if (opt_spread == true && num_warriors != 2U && opt_tourney == false
+           && opt_batch_file == NULL && opt_socket == NULL
+           && opt_num_params == 0U && opt_num_generations == 0U)
   {
-    ret_val = (n % core_size);
+    fprintf (stderr, "ERROR: Spread placements need two warrior "
+             "programmes.\n\n");
+    error = 1;
   }
 
-  return ret_val;
+  return error;
 }
 
 
-/* Loads the assembled warrior programmes into the core. */
-static void
-load_warriors (void)
+/* Normalise the given integral value N according to the modulo arithmetic
+   rules. */
+cell_addr_t
+normalise (int32_t n)
 {
-  unsigned int i, j;
-  cell_addr_t avail_range = core_size, prev_addr = 0U;
-
-  /* Initialise the core. Since both OP_DAT and MODE_IMMEDIATE have the
-     value 0, the following has the effect of setting all cells to the
-     equivalent of "DAT #0". */
-  memset (core, 0, core_size * sizeof (cell_t));
+  int32_t rem = n % (int32_t )core_size;
 
-  /* Load the warriors into the core. */
-  for (i = 0U; i < num_warriors; i++)
-  {
-    cell_addr_t start_addr
-      = ((prev_addr + max_prog_insns) + (rand () % avail_range)) % core_size;
-
-    prev_addr = start_addr;
-    avail_range -= (2 * max_prog_insns);
+  /* The remainder has the sign of N, so a negative remainder needs to be
+     brought back into range. */
+  return (cell_addr_t )(rem + ((int32_t )core_size & -(int32_t )(rem < 0)));
+}
 
-    task_t *task = (task_t *)malloc (sizeof (task_t));
-    task->pc = (start_addr + warriors[i].init_pc) % core_size;
-    task->next = task;
 
-    warriors[i].alive = true;
-    warriors[i].num_tasks = 1U;
-    warriors[i].tasks = task;
+/* Checks the size of the core and computes its reciprocal for use by
+   the modulo arithmetic routines. Returns 0 on success and a non-zero value
+   otherwise. */
+int
+mod_init (void)
+{
+  int error = 0;
 
-    for (j = 0U; j < warriors[i].num_insns; j++)
-    {
-      cell_addr_t addr = (start_addr + j) % core_size;
-
-      core[addr].marker = warriors[i].id;
-      core[addr].op_code = warriors[i].insns[j].op_code;
-      core[addr].mode_a = warriors[i].insns[j].mode_a;
-      core[addr].mode_b = warriors[i].insns[j].mode_b;
-      core[addr].op_a = warriors[i].insns[j].op_a;
-      core[addr].op_b = warriors[i].insns[j].op_b;
-    }
+  if (core_size == 0U || core_size >= INVALID_CELL_ADDR)
+  {
+    fprintf (stderr, "ERROR: Invalid core size %u.\n\n", core_size);
+    error = 1;
+  }
+#ifdef ZINC_FIXED_CORE_SIZE
+  else if (core_size != DEFAULT_CORE_SIZE)
+  {
+    fprintf (stderr, "ERROR: This build only supports a core size of %u.\n\n",
+             DEFAULT_CORE_SIZE);
+    error = 1;
+  }
+#endif
+  else
+  {
+    core_size_recip = UINT32_MAX / core_size + 1U;
   }
+
+  return error;
 }
 
 
@@ -234,31 +799,23 @@ load_warriors (void)
 int
 main (int argc, char *argv[])
 {
+  mars_t mars;
+  int error = 0;
+
   if (argc < 2)
   {
     print_usage (argv[0]);
     return EXIT_SUCCESS;
   }
 
-  for (int i = 0; i < MAX_WARRIORS; i++)
+  if (process_args (argc, argv) != 0)
   {
-    warriors[i].id = UNKNOWN_WARRIOR + i + 1;
-    warriors[i].alive = true;
-    warriors[i].file = NULL;
-    warriors[i].name = NULL;
-    warriors[i].version = NULL;
-    warriors[i].author = NULL;
-    warriors[i].num_insns = 0U;
-    warriors[i].insns = NULL;
-    warriors[i].init_pc = 0U;
-    warriors[i].num_tasks = 0U;
-    warriors[i].tasks = NULL;
-    warriors[i].score = 0U;
+    print_usage (argv[0]);
+    return EXIT_FAILURE;
   }
 
-  if (process_args (argc, argv) != 0)
+  if (mod_init () != 0)
   {
-    print_usage (argv[0]);
     return EXIT_FAILURE;
   }
 
@@ -274,13 +831,13 @@ main (int argc, char *argv[])
       {
         if (warriors[i].name == NULL)
         {
-          warriors[i].name = (char *)malloc( 10 * sizeof (char));
-          snprintf (warriors[i].name, 10, "Warrior%d", warriors[i].id);
+          warriors[i].name = (char *)malloc (20 * sizeof (char));
+          snprintf (warriors[i].name, 20, "Warrior%d", i + 1);
         }
 
         if (opt_dump_progs == true)
         {
-          dump_warrior (&warriors[i]);
+          dump_warrior (stdout, &warriors[i]);
         }
       }
     }
@@ -291,53 +848,125 @@ main (int argc, char *argv[])
     return EXIT_SUCCESS;
   }
 
-  core = (cell_t *)malloc (core_size * sizeof (cell_t));
-  if (core == NULL)
+  /* Set a seed for the random number generator. */
+  if (opt_seed_given == false)
   {
-    fprintf (stderr, "ERROR: Unable to allocate memory for core.\n\n");
-    return EXIT_FAILURE;
+    opt_seed = (uint64_t )time (NULL);
   }
 
-  /* Note that because of the values of the op codes and the addressing
-     modes, the calloc() has initialised the core to the equivalent of
-     "DAT #0". */
-
-  /* Set a seed for the random number generator. */
-  srand (time (NULL));
-
-  if (opt_no_gui == false)
+  if (opt_no_gui == true)
   {
-    if (sdlui_init (opt_full_screen) != 0)
+    if (opt_cache_file != NULL && cache_open (opt_cache_file) != 0)
     {
       return EXIT_FAILURE;
     }
+
+    if (opt_socket != NULL)
+    {
+      error = serve_run (opt_socket, max_ni_battles, opt_num_threads,
+                         opt_seed, opt_sweep_stride, opt_spread);
+      batch_free ();
+    }
+    else if (opt_batch_file != NULL)
+    {
+      FILE *in = (strcmp (opt_batch_file, "-") == 0) ? stdin
+                 : fopen (opt_batch_file, "r");
+
+      if (in == NULL)
+      {
+        fprintf (stderr, "ERROR: Unable to open \"%s\".\n\n",
+                 opt_batch_file);
+        error = 1;
+      }
+      else
+      {
+        error = batch_run (in, stdout, max_ni_battles, opt_num_threads,
+                           opt_seed, opt_sweep_stride, opt_spread);
+        if (in != stdin)
+        {
+          fclose (in);
+        }
+      }
+      batch_free ();
+    }
+    else if (opt_num_generations > 0U)
+    {
+      error = evolve_run (warriors, num_warriors, opt_num_generations,
+                          max_ni_battles, opt_num_threads, opt_seed,
+                          opt_sweep_stride, opt_spread, opt_out_dir);
+    }
+    else if (opt_num_params > 0U)
+    {
+      error = tune_run (warriors, num_warriors, opt_params, opt_num_params,
+                        max_ni_battles, opt_num_threads, opt_seed,
+                        opt_sweep_stride, opt_spread);
+    }
+    else if (opt_hill_file != NULL)
+    {
+      error = hill_challenge (opt_hill_file, opt_hill_size, max_ni_battles,
+                              opt_num_threads, opt_seed, warriors,
+                              num_warriors, opt_hill_top);
+    }
+    else if (opt_tourney == true && opt_swiss_rounds != 0U)
+    {
+      error = tourney_swiss (warriors, num_warriors, max_ni_battles,
+                             opt_num_threads, opt_seed, opt_sweep_stride,
+                             opt_spread, opt_num_workers, opt_swiss_rounds);
+    }
+    else if (opt_tourney == true)
+    {
+      error = tourney_round_robin (warriors, num_warriors, max_ni_battles,
+                                   opt_num_threads, opt_seed,
+                                   opt_seed_given, opt_sweep_stride,
+                                   opt_spread, opt_num_workers,
+                                   opt_checkpoint_file);
+    }
+    else if (opt_sweep_stride != 0U)
+    {
+      error = tourney_sweep (warriors, opt_num_threads, opt_sweep_stride);
+    }
+    else
+    {
+      error = tourney_match (warriors, num_warriors, max_ni_battles,
+                             opt_num_threads, opt_seed, opt_spread,
+                             opt_confidence);
+    }
+
+    if (cache_close () != 0)
+    {
+      error = 1;
+    }
+
+    return (error == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
   }
-  else
+
+  if (mars_init (&mars, warriors, num_warriors) != 0)
   {
-    printf ("Battle Results:\n");
+    return EXIT_FAILURE;
+  }
+
+  if (sdlui_init (opt_full_screen, &mars) != 0)
+  {
+    return EXIT_FAILURE;
   }
 
-  unsigned int num_battles = 0U;
+  /* Every load of the warriors, including one asked for before a battle
+     has started, gets placements of its own. */
+  unsigned int num_loads = 0U;
   user_wish_t cmd = RELOAD_WARRIORS;
   while (cmd == RELOAD_WARRIORS)
   {
     battle_status_t status = ZINC_FUBARED;
     unsigned int end_warrior = 0U;
 
-    load_warriors ();
-
-    if (opt_no_gui == false)
-    {
-      cmd = sdlui_start_battle ();
-    }
-    else
-    {
-      cmd = CONTINUE_BATTLE;
-    }
+    mars_seed (&mars, opt_seed, num_loads);
+    mars_load (&mars);
+    num_loads++;
 
+    cmd = sdlui_start_battle ();
     if (cmd == CONTINUE_BATTLE)
     {
-      if (exec_battle (&status, &cmd, &end_warrior) != 0)
+      if (exec_battle (&mars, &status, &cmd, &end_warrior) != 0)
       {
         return EXIT_FAILURE;
       }
@@ -349,60 +978,13 @@ main (int argc, char *argv[])
 
     if (cmd != QUIT_ZINC)
     {
-      if (opt_no_gui == false)
-      {
-        cmd = sdlui_finish_battle (status, end_warrior);
-      }
-      else
-      {
-        cmd
-          = (num_battles == (max_ni_battles - 1)) ? QUIT_ZINC
-            : RELOAD_WARRIORS;
-        printf ("%4u. ", num_battles);
-        switch (status)
-        {
-        case WARRIOR_1_KILLED:
-          printf ("\"%s\" was killed.\n", warriors[0].name);
-          break;
-
-        case WARRIOR_2_KILLED:
-          printf ("\"%s\" was killed.\n", warriors[1].name);
-          break;
-
-        case CYCLES_EXHAUSTED:
-          printf ("Timed out.\n");
-          break;
-
-        case USER_INTERRUPTED:
-          printf ("User interrupted.\n");
-          break;
-
-        case ZINC_FUBARED:
-        default:
-          fprintf (stderr, "** Internal Error ** \n");
-          break;
-        }
-      }
+      cmd = sdlui_finish_battle (status, end_warrior);
     }
-
-    num_battles++;
   }
 
-  if (opt_no_gui == false)
-  {
-    if (sdlui_quit () != 0)
-    {
-      return EXIT_FAILURE;
-    }
-  }
-  else
+  if (sdlui_quit () != 0)
   {
-    /* Print out the final scores. */
-    printf ("\nFinal Scores:\n");
-    for (int i = 0; i < num_warriors; i++)
-    {
-      printf ("    \"%s\" - %u\n", warriors[i].name, warriors[i].score);
-    }
+    return EXIT_FAILURE;
   }
 
   return EXIT_SUCCESS;
@@ -19,6 +19,9 @@
 /* The maximum number of warriors allowed in the core. */
 #define MAX_WARRIORS 2
 
+/* The maximum number of battles that can be run at once. */
+#define MAX_THREADS 64U
+
 /* The minimum number of cells separating warrior programmes. */
 #define DEFAULT_MIN_PROG_SEP 1000
 
@@ -112,17 +115,6 @@ typedef struct cell
   cell_addr_t op_b;
 } cell_t;
 
-/* A task (thread) in a warrior programme. These nodes are maintained in
-   a circular linked list; even when there is only a single task left. */
-typedef struct task
-{
-  /* The current programme counter for this task. */
-  cell_addr_t pc;
-
-  /* The next task on the task list of the warrior programme. */
-  struct task *next;
-} task_t;
-
 /* A warrior programme. */
 typedef struct warrior
 {
@@ -154,18 +146,31 @@ typedef struct warrior
      execution at. */
   cell_addr_t init_pc;
 
+  /* The address in the core at which the warrior programme was loaded. */
+  cell_addr_t load_addr;
+
   /* The current number of tasks executing for this warrior programme. */
   unsigned int num_tasks;
 
-  /* The task list for the warrior programme. This pointer always points
-     at the current node in the circular task list, or NULL if the warrior
-     has died. */
-  task_t *tasks;
+  /* The task queue for the warrior programme. This is a ring buffer with
+     room for MAX_PROG_TASKS tasks (threads), each represented by its
+     programme counter, or NULL if the warrior has not been loaded yet. */
+  cell_addr_t *task_pcs;
+
+  /* The index in TASK_PCS of the current task, i.e. the task that gets
+     to execute the next instruction of the warrior programme. The tasks
+     following it in the queue occupy the subsequent NUM_TASKS - 1 slots,
+     wrapping around at the end of the ring buffer. If the warrior has
+     died, this is the task that executed its last instruction. */
+  unsigned int curr_task;
 
   /* The score accumulated by the warrior so far. */
   uint32_t score;
 } warrior_t;
 
+/* The programme counter of the current task of the warrior W. */
+#define CURR_TASK_PC(w) ((w)->task_pcs[(w)->curr_task])
+
 /* Commands given by the user before, during or after a battle. */
 typedef enum
 {
@@ -195,15 +200,6 @@ extern unsigned int min_prog_separation;
 /* The maximum number of tasks allowed per warrior programme. */
 extern unsigned int max_prog_tasks;
 
-/* The number of loaded warrior programmes. */
-extern unsigned int num_warriors;
-
-/* The loaded warrior programmes. */
-extern warrior_t warriors[];
-
-/* The core. */
-extern cell_t *core;
-
 /* Whether to show the GUI or just use the command-line interface. */
 extern bool opt_no_gui;
 